@@ -7,6 +7,8 @@
 #include <vector>
 #include <algorithm>
 #include "platformutil.h"
+#include "stringutil.h"
+#include "md5.h"
 
 // Windows uses UTF-16, but we use UTF-8 internally
 #if PLATFORM_WIN
@@ -40,17 +42,33 @@ struct IOStream
   virtual size_t size() const = 0;
   virtual size_t readp(void** pdest, size_t len) = 0;  // read into buffer owned by stream
   virtual int type() const = 0;
-  enum StreamType { MEMSTREAM = 1, FILESTREAM = 2, UIDOCSTREAM = 4 };
+  enum StreamType { MEMSTREAM = 1, FILESTREAM = 2, UIDOCSTREAM = 4, BASE64STREAM = 8 };
 
   size_t write(const char* s) { return write(s, strlen(s)); }
   IOStream& operator<<(const char* s) { write(s); return *this; }
-  IOStream& operator<<(std::string s) { write(s.data(), s.size()); return *this; }
+  IOStream& operator<<(const std::string& s) { write(s.data(), s.size()); return *this; }
 
   static size_t readfn(void* dest, size_t len, void* self) { return static_cast<IOStream*>(self)->read(dest, len); }
   static size_t writefn(const void* src, size_t len, void* self) { return static_cast<IOStream*>(self)->write(src, len); }
   static void seekfn(long offset, int origin, void* self) { static_cast<IOStream*>(self)->seek(offset, origin); }
+  static size_t readpfn(void** pdest, size_t len, void* self) { return static_cast<IOStream*>(self)->readp(pdest, len); }
+  static bool truncatefn(size_t len, void* self) { return static_cast<IOStream*>(self)->truncate(len); }
 };
 
+// hash up to maxlen bytes read from strm (starting at current position); returns number of bytes hashed
+inline uint64_t MD5(IOStream& strm, uint8_t* digest, uint64_t maxlen = UINT64_MAX)
+{
+  MD5_CTX ctx;
+  MD5_init(&ctx);
+  void* buf = NULL;
+  size_t n = 0;
+  while(ctx.count < maxlen && (n = strm.readp(&buf, size_t(std::min(maxlen - ctx.count, uint64_t(1) << 16)))) > 0)
+    MD5_update(&ctx, buf, n);
+  uint64_t len = ctx.count;
+  memcpy(digest, MD5_final(&ctx), MD5_DIGEST_SIZE);
+  return len;
+}
+
 struct MemStream : public IOStream
 {
   char* buffer = NULL;
@@ -128,6 +146,59 @@ struct ConstMemStream : public MemStream
   //int type() const override { return CONST_MEMSTREAM;  }
 };
 
+// base64 streams wrapping another stream - can be passed to gzip()/gunzip() w/ minigz_io_t to handle base64
+//  encoded gzip data in a single pass, e.g. gunzip(minigz_io_t(b64decstrm), minigz_io_t(outstrm))
+// write() encodes and writes to strm; call finish() (done by destructor) to write final padded group
+struct Base64EncodeStream : public IOStream
+{
+  IOStream& strm;
+  Base64Encoder encoder;
+  std::vector<char> buff;
+  size_t nwritten = 0;
+
+  Base64EncodeStream(IOStream& _strm) : strm(_strm) {}
+  ~Base64EncodeStream() override { finish(); }
+  bool finish();
+
+  size_t read(void* dest, size_t len) override { return 0; }
+  size_t write(const void* src, size_t len) override;
+  long tell() const override { return (long)nwritten; }
+  bool seek(long offset, int origin = SEEK_SET) override { return false; }
+  bool flush() override { return strm.flush(); }
+  bool truncate(size_t len) override { return false; }
+  size_t size() const override { return nwritten; }
+  size_t readp(void** pdest, size_t len) override { return 0; }
+  int type() const override { return BASE64STREAM; }
+};
+
+// read() reads base64 text from strm and returns decoded data; write() decodes and writes to strm - use one or
+//  the other, not both; seeking is supported forward and backward within data returned by last read() (as
+//  needed by gunzip())
+struct Base64DecodeStream : public IOStream
+{
+  IOStream& strm;
+  Base64Decoder decoder;
+  std::vector<char> text;
+  std::vector<unsigned char> buff;  // decoded data
+  size_t buffpos = 0;
+  size_t buffend = 0;
+  size_t basepos = 0;  // stream position of buff[0]
+
+  Base64DecodeStream(IOStream& _strm) : strm(_strm) {}
+
+  size_t read(void* dest, size_t len) override;
+  size_t write(const void* src, size_t len) override;
+  long tell() const override { return long(basepos + buffpos); }
+  bool seek(long offset, int origin = SEEK_SET) override;
+  bool truncate(size_t len) override { return false; }
+  size_t size() const override { return SIZE_MAX; }  // unknown
+  size_t readp(void** pdest, size_t len) override;
+  int type() const override { return BASE64STREAM; }
+
+private:
+  size_t fill(size_t len);
+};
+
 // not quite ready to commit to C++17...
 class FSPath
 {
@@ -249,6 +320,101 @@ size_t MemStream::write(const void* src, size_t len)
   return len;
 }
 
+// process in chunks to limit size of temporary buffer
+static constexpr size_t BASE64_STREAM_CHUNK = 1 << 16;
+
+size_t Base64EncodeStream::write(const void* src, size_t len)
+{
+  const unsigned char* p = (const unsigned char*)src;
+  for(size_t rem = len; rem > 0;) {
+    size_t n = std::min(rem, BASE64_STREAM_CHUNK);
+    buff.resize(Base64Encoder::maxEncodedLen(n + 2));
+    size_t nout = encoder.encode(p, n, buff.data());
+    if(strm.write(buff.data(), nout) != nout)
+      return len - rem;
+    nwritten += n;
+    p += n;
+    rem -= n;
+  }
+  return len;
+}
+
+bool Base64EncodeStream::finish()
+{
+  char tail[4];
+  size_t n = encoder.finish(tail);
+  return strm.write(tail, n) == n;
+}
+
+size_t Base64DecodeStream::write(const void* src, size_t len)
+{
+  const char* p = (const char*)src;
+  for(size_t rem = len; rem > 0;) {
+    size_t n = std::min(rem, BASE64_STREAM_CHUNK);
+    buff.resize(Base64Decoder::maxDecodedLen(n));
+    size_t nout = decoder.decode(p, n, buff.data());
+    if(strm.write(buff.data(), nout) != nout)
+      return len - rem;
+    p += n;
+    rem -= n;
+  }
+  return len;
+}
+
+// discard data already read, then decode until len bytes are available or end of strm is reached
+size_t Base64DecodeStream::fill(size_t len)
+{
+  if(buffpos > 0) {
+    memmove(buff.data(), buff.data() + buffpos, buffend - buffpos);
+    basepos += buffpos;
+    buffend -= buffpos;
+    buffpos = 0;
+  }
+  while(buffend < len) {
+    size_t ntext = std::max(size_t(4096), 4*(len - buffend)/3 + 4);
+    text.resize(ntext);
+    ntext = strm.read(text.data(), ntext);
+    if(ntext == 0)
+      break;
+    buff.resize(buffend + Base64Decoder::maxDecodedLen(ntext));
+    buffend += decoder.decode(text.data(), ntext, buff.data() + buffend);
+  }
+  return std::min(len, buffend);
+}
+
+size_t Base64DecodeStream::read(void* dest, size_t len)
+{
+  len = fill(len);
+  memcpy(dest, buff.data(), len);
+  buffpos = len;
+  return len;
+}
+
+size_t Base64DecodeStream::readp(void** pdest, size_t len)
+{
+  len = fill(len);
+  *pdest = buff.data();
+  buffpos = len;
+  return len;
+}
+
+bool Base64DecodeStream::seek(long offset, int origin)
+{
+  if(origin == SEEK_END)
+    return false;
+  size_t target = origin == SEEK_CUR ? tell() + offset : offset;
+  if(target < basepos)
+    return false;
+  if(target <= basepos + buffend) {
+    buffpos = target - basepos;
+    return true;
+  }
+  // skip forward
+  buffpos = buffend;
+  buffpos = fill(target - tell());
+  return tell() == long(target);
+}
+
 // writable = file && mode && mode[0] && (mode[0] != 'r' || mode[1] == '+' || (mode[1] && mode[2] == '+'));
 bool FileStream::truncate(size_t len)
 {
@@ -27,6 +27,7 @@
 #include <utility>
 #include "image.h"
 #include "painter.h"
+#include "stringutil.h"
 
 Image::Image(int w, int h, Encoding imgfmt) : Image(w, h, NULL, imgfmt)
 {
@@ -184,6 +185,14 @@ bool Image::operator==(const Image& other) const
   return memcmp(constBytes(), other.constBytes(), dataLen()) == 0;
 }
 
+// seed distinguishes pixel and encoded data hashes
+Hash128 Image::contentHash() const
+{
+  if(data)
+    return fastHash128(data, dataLen(), (uint64_t(width) << 32) | uint32_t(height));
+  return fastHash128(encData.data(), encData.size(), ~uint64_t(0));
+}
+
 bool Image::hasTransparency() const
 {
   if(encoding == JPEG && !data) return false;  // unmodified from JPEG source implies no transparency
@@ -4,6 +4,8 @@
 #include <vector>
 #include "geom.h"
 
+struct Hash128;  // stringutil.h
+
 #define USE_STB_IMAGE
 
 class Image {
@@ -47,6 +49,8 @@ public:
   bool isNull() const { return !data && encData.empty(); }
   bool operator==(const Image& other) const;
   bool operator!=(const Image& other) const { return !operator==(other); }
+  // hash of pixels if decoded, else of encoded data (so result may change when image is decoded)
+  Hash128 contentHash() const;
 
   //enum PixelFormat {ARGB32, ARGB32_Premul, RGB32};
   //PixelFormat format() const { return ARGB32; }
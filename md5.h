@@ -4,101 +4,137 @@
 #ifndef MD5_H
 #define MD5_H
 #include <stdint.h>
+#include <stddef.h>
 
 #define MD5_DIGEST_SIZE 16
-const uint8_t* MD5(const void* data, int len, uint8_t* digest);
+
+typedef struct
+{
+  uint64_t count;
+  uint8_t buf[64];
+  uint32_t state[4];
+} MD5_CTX;
+
+// incremental hashing - MD5_final returns digest (stored in ctx->buf)
+void MD5_init(MD5_CTX* ctx);
+void MD5_update(MD5_CTX* ctx, const void* data, size_t len);
+const uint8_t* MD5_final(MD5_CTX* ctx);
+
+const uint8_t* MD5(const void* data, size_t len, uint8_t* digest);
+char* MD5hex(const void* data, size_t len, char* hexout);  // len = 0 for strlen(data)
+
+// hash n independent buffers, w/ 8 (AVX2) or 4 (SSE2) buffers processed at once in SIMD lanes; digest for
+//  data[ii] is written to digests + ii*MD5_DIGEST_SIZE
+void MD5_multi(int n, const void* const* data, const size_t* lens, uint8_t* digests);
 
 #endif
 
 #ifdef MD5_IMPLEMENTATION
 #undef MD5_IMPLEMENTATION
+#include <string.h>
 
 #define rol(bits, value) (((value) << (bits)) | ((value) >> (32 - (bits))))
 
-static const uint32_t Kr[64] =
+static inline uint32_t MD5_load32(const uint8_t* p)
 {
-  7, 12, 17, 22,  7, 12, 17, 22,  7, 12, 17, 22,  7, 12, 17, 22,
-  5,  9, 14, 20,  5,  9, 14, 20,  5,  9, 14, 20,  5,  9, 14, 20,
-  4, 11, 16, 23,  4, 11, 16, 23,  4, 11, 16, 23,  4, 11, 16, 23,
-  6, 10, 15, 21,  6, 10, 15, 21,  6, 10, 15, 21,  6, 10, 15, 21
-};
+  return p[0] | (p[1] << 8) | (p[2] << 16) | (uint32_t(p[3]) << 24);
+}
 
-static const uint32_t KK[64] =
-{
-  0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee,
-  0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
-  0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be,
-  0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
-  0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa,
-  0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
-  0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed,
-  0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
-  0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c,
-  0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
-  0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05,
-  0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
-  0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039,
-  0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
-  0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1,
-  0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391
-};
+// unrolled transform for scalar or vector type T (which needs +, ^, &, |, ~, <<, >> and + uint32_t)
+#define MD5_F1(x, y, z) (z ^ (x & (y ^ z)))
+#define MD5_F2(x, y, z) (y ^ (z & (x ^ y)))
+#define MD5_F3(x, y, z) (x ^ y ^ z)
+#define MD5_F4(x, y, z) (y ^ (x | ~z))
+#define MD5_STEP(f, a, b, c, d, w, k, s) a = a + f(b, c, d) + w + k; a = rol(s, a) + b
 
-typedef struct
+template<class T>
+static void MD5_TransformW(T* state, const T* W)
 {
-  uint64_t count;
-  uint8_t buf[64];
-  uint32_t state[4];
-} MD5_CTX;
+  T a = state[0], b = state[1], c = state[2], d = state[3];
 
-static void MD5_Transform(MD5_CTX* ctx)
-{
-  uint32_t W[64];
-  uint32_t A, B, C, D;
-  uint8_t* p = ctx->buf;
-  int t;
-
-  for(t = 0; t < 16; ++t) {
-    uint32_t tmp =  *p++;
-    tmp |= *p++ << 8;
-    tmp |= *p++ << 16;
-    tmp |= *p++ << 24;
-    W[t] = tmp;
-  }
+  MD5_STEP(MD5_F1, a, b, c, d, W[ 0], 0xd76aa478,  7);
+  MD5_STEP(MD5_F1, d, a, b, c, W[ 1], 0xe8c7b756, 12);
+  MD5_STEP(MD5_F1, c, d, a, b, W[ 2], 0x242070db, 17);
+  MD5_STEP(MD5_F1, b, c, d, a, W[ 3], 0xc1bdceee, 22);
+  MD5_STEP(MD5_F1, a, b, c, d, W[ 4], 0xf57c0faf,  7);
+  MD5_STEP(MD5_F1, d, a, b, c, W[ 5], 0x4787c62a, 12);
+  MD5_STEP(MD5_F1, c, d, a, b, W[ 6], 0xa8304613, 17);
+  MD5_STEP(MD5_F1, b, c, d, a, W[ 7], 0xfd469501, 22);
+  MD5_STEP(MD5_F1, a, b, c, d, W[ 8], 0x698098d8,  7);
+  MD5_STEP(MD5_F1, d, a, b, c, W[ 9], 0x8b44f7af, 12);
+  MD5_STEP(MD5_F1, c, d, a, b, W[10], 0xffff5bb1, 17);
+  MD5_STEP(MD5_F1, b, c, d, a, W[11], 0x895cd7be, 22);
+  MD5_STEP(MD5_F1, a, b, c, d, W[12], 0x6b901122,  7);
+  MD5_STEP(MD5_F1, d, a, b, c, W[13], 0xfd987193, 12);
+  MD5_STEP(MD5_F1, c, d, a, b, W[14], 0xa679438e, 17);
+  MD5_STEP(MD5_F1, b, c, d, a, W[15], 0x49b40821, 22);
 
-  A = ctx->state[0];
-  B = ctx->state[1];
-  C = ctx->state[2];
-  D = ctx->state[3];
-
-  for(t = 0; t < 64; t++) {
-    uint32_t f, tmp;
-    int g;
-
-    if (t < 16) {
-      f = (D^(B&(C^D)));
-      g = t;
-    } else if (t < 32) {
-      f = (C^(D&(B^C)));
-      g = (5*t + 1) & 15;
-    } else if (t < 48) {
-      f = (B^C^D);
-      g = (3*t + 5) & 15;
-    } else {
-      f = (C^(B|(~D)));
-      g = (7*t) & 15;
-    }
+  MD5_STEP(MD5_F2, a, b, c, d, W[ 1], 0xf61e2562,  5);
+  MD5_STEP(MD5_F2, d, a, b, c, W[ 6], 0xc040b340,  9);
+  MD5_STEP(MD5_F2, c, d, a, b, W[11], 0x265e5a51, 14);
+  MD5_STEP(MD5_F2, b, c, d, a, W[ 0], 0xe9b6c7aa, 20);
+  MD5_STEP(MD5_F2, a, b, c, d, W[ 5], 0xd62f105d,  5);
+  MD5_STEP(MD5_F2, d, a, b, c, W[10], 0x02441453,  9);
+  MD5_STEP(MD5_F2, c, d, a, b, W[15], 0xd8a1e681, 14);
+  MD5_STEP(MD5_F2, b, c, d, a, W[ 4], 0xe7d3fbc8, 20);
+  MD5_STEP(MD5_F2, a, b, c, d, W[ 9], 0x21e1cde6,  5);
+  MD5_STEP(MD5_F2, d, a, b, c, W[14], 0xc33707d6,  9);
+  MD5_STEP(MD5_F2, c, d, a, b, W[ 3], 0xf4d50d87, 14);
+  MD5_STEP(MD5_F2, b, c, d, a, W[ 8], 0x455a14ed, 20);
+  MD5_STEP(MD5_F2, a, b, c, d, W[13], 0xa9e3e905,  5);
+  MD5_STEP(MD5_F2, d, a, b, c, W[ 2], 0xfcefa3f8,  9);
+  MD5_STEP(MD5_F2, c, d, a, b, W[ 7], 0x676f02d9, 14);
+  MD5_STEP(MD5_F2, b, c, d, a, W[12], 0x8d2a4c8a, 20);
 
-    tmp = D;
-    D = C;
-    C = B;
-    B = B + rol(Kr[t], (A+f+KK[t]+W[g]));
-    A = tmp;
-  }
+  MD5_STEP(MD5_F3, a, b, c, d, W[ 5], 0xfffa3942,  4);
+  MD5_STEP(MD5_F3, d, a, b, c, W[ 8], 0x8771f681, 11);
+  MD5_STEP(MD5_F3, c, d, a, b, W[11], 0x6d9d6122, 16);
+  MD5_STEP(MD5_F3, b, c, d, a, W[14], 0xfde5380c, 23);
+  MD5_STEP(MD5_F3, a, b, c, d, W[ 1], 0xa4beea44,  4);
+  MD5_STEP(MD5_F3, d, a, b, c, W[ 4], 0x4bdecfa9, 11);
+  MD5_STEP(MD5_F3, c, d, a, b, W[ 7], 0xf6bb4b60, 16);
+  MD5_STEP(MD5_F3, b, c, d, a, W[10], 0xbebfbc70, 23);
+  MD5_STEP(MD5_F3, a, b, c, d, W[13], 0x289b7ec6,  4);
+  MD5_STEP(MD5_F3, d, a, b, c, W[ 0], 0xeaa127fa, 11);
+  MD5_STEP(MD5_F3, c, d, a, b, W[ 3], 0xd4ef3085, 16);
+  MD5_STEP(MD5_F3, b, c, d, a, W[ 6], 0x04881d05, 23);
+  MD5_STEP(MD5_F3, a, b, c, d, W[ 9], 0xd9d4d039,  4);
+  MD5_STEP(MD5_F3, d, a, b, c, W[12], 0xe6db99e5, 11);
+  MD5_STEP(MD5_F3, c, d, a, b, W[15], 0x1fa27cf8, 16);
+  MD5_STEP(MD5_F3, b, c, d, a, W[ 2], 0xc4ac5665, 23);
+
+  MD5_STEP(MD5_F4, a, b, c, d, W[ 0], 0xf4292244,  6);
+  MD5_STEP(MD5_F4, d, a, b, c, W[ 7], 0x432aff97, 10);
+  MD5_STEP(MD5_F4, c, d, a, b, W[14], 0xab9423a7, 15);
+  MD5_STEP(MD5_F4, b, c, d, a, W[ 5], 0xfc93a039, 21);
+  MD5_STEP(MD5_F4, a, b, c, d, W[12], 0x655b59c3,  6);
+  MD5_STEP(MD5_F4, d, a, b, c, W[ 3], 0x8f0ccc92, 10);
+  MD5_STEP(MD5_F4, c, d, a, b, W[10], 0xffeff47d, 15);
+  MD5_STEP(MD5_F4, b, c, d, a, W[ 1], 0x85845dd1, 21);
+  MD5_STEP(MD5_F4, a, b, c, d, W[ 8], 0x6fa87e4f,  6);
+  MD5_STEP(MD5_F4, d, a, b, c, W[15], 0xfe2ce6e0, 10);
+  MD5_STEP(MD5_F4, c, d, a, b, W[ 6], 0xa3014314, 15);
+  MD5_STEP(MD5_F4, b, c, d, a, W[13], 0x4e0811a1, 21);
+  MD5_STEP(MD5_F4, a, b, c, d, W[ 4], 0xf7537e82,  6);
+  MD5_STEP(MD5_F4, d, a, b, c, W[11], 0xbd3af235, 10);
+  MD5_STEP(MD5_F4, c, d, a, b, W[ 2], 0x2ad7d2bb, 15);
+  MD5_STEP(MD5_F4, b, c, d, a, W[ 9], 0xeb86d391, 21);
+
+  state[0] = state[0] + a;
+  state[1] = state[1] + b;
+  state[2] = state[2] + c;
+  state[3] = state[3] + d;
+}
 
-  ctx->state[0] += A;
-  ctx->state[1] += B;
-  ctx->state[2] += C;
-  ctx->state[3] += D;
+// process nblocks 64 byte blocks directly from p (compilers turn MD5_load32 into a plain load)
+static void MD5_Transform(uint32_t* state, const uint8_t* p, size_t nblocks)
+{
+  uint32_t W[16];
+  for(size_t ii = 0; ii < nblocks; ++ii, p += 64) {
+    for(int jj = 0; jj < 16; ++jj)
+      W[jj] = MD5_load32(p + 4*jj);
+    MD5_TransformW(state, W);
+  }
 }
 
 void MD5_init(MD5_CTX* ctx)
@@ -110,39 +146,46 @@ void MD5_init(MD5_CTX* ctx)
   ctx->count = 0;
 }
 
-void MD5_update(MD5_CTX* ctx, const void* data, int len)
+void MD5_update(MD5_CTX* ctx, const void* data, size_t len)
 {
-  int i = ctx->count & 63;
+  size_t nbuf = ctx->count & 63;
   const uint8_t* p = (const uint8_t*)data;
 
   ctx->count += len;
-
-  while (len--) {
-    ctx->buf[i++] = *p++;
-    if (i == 64) {
-      MD5_Transform(ctx);
-      i = 0;
-    }
+  if(nbuf > 0) {
+    size_t n = len < 64 - nbuf ? len : 64 - nbuf;
+    memcpy(ctx->buf + nbuf, p, n);
+    p += n;
+    len -= n;
+    if(nbuf + n < 64)
+      return;
+    MD5_Transform(ctx->state, ctx->buf, 1);
   }
+  // whole blocks are hashed in place; only the remainder is copied to buf
+  MD5_Transform(ctx->state, p, len/64);
+  memcpy(ctx->buf, p + (len & ~size_t(63)), len & 63);
 }
 
 const uint8_t* MD5_final(MD5_CTX* ctx)
 {
   uint8_t* p = ctx->buf;
   uint64_t cnt = ctx->count * 8;
-  int i;
+  size_t nbuf = ctx->count & 63;
 
-  MD5_update(ctx, (uint8_t*)"\x80", 1);
-  while ((ctx->count & 63) != 56) {
-    MD5_update(ctx, (uint8_t*)"\0", 1);
-  }
-  for (i = 0; i < 8; ++i) {
-    uint8_t tmp = cnt >> (i * 8);
-    MD5_update(ctx, &tmp, 1);
+  // padding: 0x80, then zeros up to 56 mod 64, then length in bits
+  p[nbuf++] = 0x80;
+  if(nbuf > 56) {
+    memset(p + nbuf, 0, 64 - nbuf);
+    MD5_Transform(ctx->state, p, 1);
+    nbuf = 0;
   }
+  memset(p + nbuf, 0, 56 - nbuf);
+  for(int ii = 0; ii < 8; ++ii)
+    p[56 + ii] = uint8_t(cnt >> (ii * 8));
+  MD5_Transform(ctx->state, p, 1);
 
-  for (i = 0; i < 4; i++) {
-    uint32_t tmp = ctx->state[i];
+  for(int ii = 0; ii < 4; ii++) {
+    uint32_t tmp = ctx->state[ii];
     *p++ = tmp;
     *p++ = tmp >> 8;
     *p++ = tmp >> 16;
@@ -152,7 +195,7 @@ const uint8_t* MD5_final(MD5_CTX* ctx)
   return ctx->buf;
 }
 
-const uint8_t* MD5(const void* data, int len, uint8_t* digest)
+const uint8_t* MD5(const void* data, size_t len, uint8_t* digest)
 {
   MD5_CTX ctx;
   MD5_init(&ctx);
@@ -161,7 +204,7 @@ const uint8_t* MD5(const void* data, int len, uint8_t* digest)
   return digest;
 }
 
-char* MD5hex(const void* data, int len, char* hexout)
+char* MD5hex(const void* data, size_t len, char* hexout)
 {
   static const char* hexDigits = "0123456789abcdef";  // whiteboard server expects lowercase(!)
 
@@ -174,4 +217,272 @@ char* MD5hex(const void* data, int len, char* hexout)
   hexout[2*MD5_DIGEST_SIZE] = '\0';
   return hexout;
 }
+
+// multi-buffer MD5: each SIMD lane hashes a different buffer; when a lane finishes, it is refilled w/ the next
+//  buffer, so buffers of different lengths don't leave lanes idle (until the end)
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define MD5_MB_LANES 8
+struct md5v { __m256i v; };
+static inline md5v md5v_loadu(const uint32_t* p) { return {_mm256_loadu_si256((const __m256i*)p)}; }
+static inline void md5v_storeu(uint32_t* p, md5v a) { _mm256_storeu_si256((__m256i*)p, a.v); }
+static inline md5v operator+(md5v a, md5v b) { return {_mm256_add_epi32(a.v, b.v)}; }
+static inline md5v operator+(md5v a, uint32_t k) { return {_mm256_add_epi32(a.v, _mm256_set1_epi32(int(k)))}; }
+static inline md5v operator^(md5v a, md5v b) { return {_mm256_xor_si256(a.v, b.v)}; }
+static inline md5v operator&(md5v a, md5v b) { return {_mm256_and_si256(a.v, b.v)}; }
+static inline md5v operator|(md5v a, md5v b) { return {_mm256_or_si256(a.v, b.v)}; }
+static inline md5v operator~(md5v a) { return {_mm256_xor_si256(a.v, _mm256_set1_epi32(-1))}; }
+static inline md5v operator<<(md5v a, int s) { return {_mm256_sll_epi32(a.v, _mm_cvtsi32_si128(s))}; }
+static inline md5v operator>>(md5v a, int s) { return {_mm256_srl_epi32(a.v, _mm_cvtsi32_si128(s))}; }
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define MD5_MB_LANES 4
+struct md5v { __m128i v; };
+static inline md5v md5v_loadu(const uint32_t* p) { return {_mm_loadu_si128((const __m128i*)p)}; }
+static inline void md5v_storeu(uint32_t* p, md5v a) { _mm_storeu_si128((__m128i*)p, a.v); }
+static inline md5v operator+(md5v a, md5v b) { return {_mm_add_epi32(a.v, b.v)}; }
+static inline md5v operator+(md5v a, uint32_t k) { return {_mm_add_epi32(a.v, _mm_set1_epi32(int(k)))}; }
+static inline md5v operator^(md5v a, md5v b) { return {_mm_xor_si128(a.v, b.v)}; }
+static inline md5v operator&(md5v a, md5v b) { return {_mm_and_si128(a.v, b.v)}; }
+static inline md5v operator|(md5v a, md5v b) { return {_mm_or_si128(a.v, b.v)}; }
+static inline md5v operator~(md5v a) { return {_mm_xor_si128(a.v, _mm_set1_epi32(-1))}; }
+static inline md5v operator<<(md5v a, int s) { return {_mm_sll_epi32(a.v, _mm_cvtsi32_si128(s))}; }
+static inline md5v operator>>(md5v a, int s) { return {_mm_srl_epi32(a.v, _mm_cvtsi32_si128(s))}; }
+#endif
+
+#ifdef MD5_MB_LANES
+static void MD5_store_digest(const uint32_t* state, size_t stride, uint8_t* digest)
+{
+  for(int ii = 0; ii < 4; ++ii) {
+    uint32_t x = state[ii*stride];
+    *digest++ = x;
+    *digest++ = x >> 8;
+    *digest++ = x >> 16;
+    *digest++ = x >> 24;
+  }
+}
+#endif
+
+void MD5_multi(int n, const void* const* data, const size_t* lens, uint8_t* digests)
+{
+#ifdef MD5_MB_LANES
+  struct Lane
+  {
+    int idx = -1;  // index of buffer or -1 if idle
+    const uint8_t* p;
+    size_t block, nfull, nblocks;
+    uint8_t tail[128];  // last 1 or 2 blocks, w/ padding and length
+  } lanes[MD5_MB_LANES];
+  static const uint8_t zeros[64] = {0};
+  uint32_t st[4][MD5_MB_LANES];
+  int next = 0, active = 0;
+
+  auto start = [&](int ln) {
+    Lane& lane = lanes[ln];
+    lane.idx = next < n ? next++ : -1;
+    if(lane.idx < 0) return;
+    size_t len = lens[lane.idx];
+    lane.p = (const uint8_t*)data[lane.idx];
+    lane.block = 0;
+    lane.nfull = len/64;
+    lane.nblocks = (len + 8)/64 + 1;
+    size_t rem = len - lane.nfull*64, ntail = (lane.nblocks - lane.nfull)*64;
+    memcpy(lane.tail, lane.p + lane.nfull*64, rem);
+    memset(lane.tail + rem, 0, ntail - rem);
+    lane.tail[rem] = 0x80;
+    uint64_t bits = uint64_t(len)*8;
+    for(int ii = 0; ii < 8; ++ii)
+      lane.tail[ntail - 8 + ii] = uint8_t(bits >> (ii*8));
+    st[0][ln] = 0x67452301;
+    st[1][ln] = 0xEFCDAB89;
+    st[2][ln] = 0x98BADCFE;
+    st[3][ln] = 0x10325476;
+    ++active;
+  };
+
+  for(int ln = 0; ln < MD5_MB_LANES; ++ln)
+    start(ln);
+  while(active > 0) {
+    const uint8_t* blk[MD5_MB_LANES];
+    for(int ln = 0; ln < MD5_MB_LANES; ++ln) {
+      const Lane& lane = lanes[ln];
+      if(lane.idx < 0)
+        blk[ln] = zeros;
+      else
+        blk[ln] = lane.block < lane.nfull ? lane.p + lane.block*64 : lane.tail + (lane.block - lane.nfull)*64;
+    }
+    // transpose input: W[jj] holds word jj of each lane's block
+    md5v W[16], state[4];
+    uint32_t w[MD5_MB_LANES];
+    for(int jj = 0; jj < 16; ++jj) {
+      for(int ln = 0; ln < MD5_MB_LANES; ++ln)
+        w[ln] = MD5_load32(blk[ln] + 4*jj);
+      W[jj] = md5v_loadu(w);
+    }
+    for(int ii = 0; ii < 4; ++ii)
+      state[ii] = md5v_loadu(st[ii]);
+    MD5_TransformW(state, W);
+    for(int ii = 0; ii < 4; ++ii)
+      md5v_storeu(st[ii], state[ii]);
+
+    for(int ln = 0; ln < MD5_MB_LANES; ++ln) {
+      Lane& lane = lanes[ln];
+      if(lane.idx >= 0 && ++lane.block == lane.nblocks) {
+        MD5_store_digest(&st[0][ln], MD5_MB_LANES, digests + lane.idx*MD5_DIGEST_SIZE);
+        --active;
+        start(ln);
+      }
+    }
+  }
+#else
+  for(int ii = 0; ii < n; ++ii)
+    MD5(data[ii], lens[ii], digests + ii*MD5_DIGEST_SIZE);
+#endif
+}
+
+#endif
+
+// g++ -x c++ -O2 -march=native -I../stb -DMD5_TEST -DMD5_IMPLEMENTATION -o md5test md5.h
+// ./md5test --bench for throughput in MB/s
+#ifdef MD5_TEST
+#undef MD5_TEST
+#include "fileutil.h"  // to test MD5(IOStream&)
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <assert.h>
+
+static std::string md5str(const uint8_t* digest)
+{
+  char hex[2*MD5_DIGEST_SIZE + 1];
+  for(int ii = 0; ii < MD5_DIGEST_SIZE; ++ii)
+    snprintf(hex + 2*ii, 3, "%02x", digest[ii]);
+  return hex;
+}
+
+template<class F>
+static double md5_bench_mbps(size_t bytes, F fn)
+{
+  double best = 1E9;
+  for(int rep = 0; rep < 5; ++rep) {
+    auto t0 = std::chrono::steady_clock::now();
+    fn();
+    best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count());
+  }
+  return bytes/best/1E6;
+}
+
+// md5test --bench: throughput of one-shot, incremental (in small pieces), and multi-buffer hashing
+static void md5_bench()
+{
+  std::string big(64 << 20, '\0');
+  for(char& c : big) c = char(rand());
+  uint8_t digest[MD5_DIGEST_SIZE];
+  printf("MD5 one-shot: %.0f MB/s\n", md5_bench_mbps(big.size(), [&](){ MD5(big.data(), big.size(), digest); }));
+  for(size_t chunk : {size_t(13), size_t(100), size_t(4096)}) {
+    double mbps = md5_bench_mbps(big.size(), [&](){
+      MD5_CTX ctx;
+      MD5_init(&ctx);
+      for(size_t pos = 0; pos < big.size(); pos += chunk)
+        MD5_update(&ctx, &big[pos], std::min(chunk, big.size() - pos));
+      MD5_final(&ctx);
+    });
+    printf("MD5_update(%d bytes): %.0f MB/s\n", int(chunk), mbps);
+  }
+  const int nbufs = 64;
+  std::vector<const void*> ptrs;
+  std::vector<size_t> lens(nbufs, big.size()/nbufs);
+  std::vector<uint8_t> digests(nbufs*MD5_DIGEST_SIZE);
+  for(int ii = 0; ii < nbufs; ++ii)
+    ptrs.push_back(&big[ii*lens[ii]]);
+  printf("MD5_multi(%d x %d KB): %.0f MB/s\n", nbufs, int(lens[0] >> 10), md5_bench_mbps(big.size(),
+      [&](){ MD5_multi(nbufs, ptrs.data(), lens.data(), digests.data()); }));
+}
+
+// minimal read-only stream, so test doesn't need FILEUTIL_IMPLEMENTATION for MemStream
+struct TestStream : public IOStream
+{
+  const char* p;
+  size_t n, pos = 0;
+
+  TestStream(const std::string& s) : p(s.data()), n(s.size()) {}
+  size_t read(void* dest, size_t len) override { return 0; }
+  size_t write(const void* src, size_t len) override { return 0; }
+  long tell() const override { return long(pos); }
+  bool seek(long offset, int origin = SEEK_SET) override { return false; }
+  bool truncate(size_t len) override { return false; }
+  size_t size() const override { return n; }
+  size_t readp(void** pdest, size_t len) override
+    { *pdest = (void*)(p + pos); len = std::min(len, n - pos); pos += len; return len; }
+  int type() const override { return 0; }
+};
+
+int main(int argc, char* argv[])
+{
+  // RFC 1321 test suite
+  const char* rfc[][2] = {
+    {"", "d41d8cd98f00b204e9800998ecf8427e"},
+    {"a", "0cc175b9c0f1b6a831c399e269772661"},
+    {"abc", "900150983cd24fb0d6963f7d28e17f72"},
+    {"message digest", "f96b697d7cb7938d525a2f31aaf161d0"},
+    {"abcdefghijklmnopqrstuvwxyz", "c3fcd3d76192e4007dfb496cca67e13b"},
+    {"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789", "d174ab98d277d9f5a5611c2c9f419d9f"},
+    {"12345678901234567890123456789012345678901234567890123456789012345678901234567890",
+        "57edf4a22be3c955ac49da2e2107b67a"}
+  };
+  uint8_t digest[MD5_DIGEST_SIZE];
+  char hex[2*MD5_DIGEST_SIZE + 1];
+  for(auto& t : rfc) {
+    assert(md5str(MD5(t[0], strlen(t[0]), digest)) == t[1]);
+    if(t[0][0]) assert(strcmp(MD5hex(t[0], 0, hex), t[1]) == 0);
+  }
+
+  std::vector<std::string> bufs;
+  for(size_t len = 0; len < 300; len += 1 + len/8)
+    bufs.push_back(std::string(len, '\0'));
+  bufs.push_back(std::string(100000, '\0'));
+  for(std::string& s : bufs)
+    for(char& c : s) c = char(rand());
+
+  // incremental and IOStream hashing match one-shot
+  for(const std::string& s : bufs) {
+    uint8_t ref[MD5_DIGEST_SIZE];
+    MD5(s.data(), s.size(), ref);
+    MD5_CTX ctx;
+    MD5_init(&ctx);
+    for(size_t pos = 0; pos < s.size();) {
+      size_t n = std::min(s.size() - pos, size_t(rand() % 100));
+      MD5_update(&ctx, &s[pos], n);
+      pos += n;
+    }
+    assert(memcmp(MD5_final(&ctx), ref, MD5_DIGEST_SIZE) == 0);
+    TestStream strm(s);
+    assert(MD5(strm, digest) == s.size() && memcmp(digest, ref, MD5_DIGEST_SIZE) == 0);
+    if(s.size() > 10) {
+      TestStream strm2(s);
+      MD5(s.data(), 10, ref);
+      assert(MD5(strm2, digest, 10) == 10 && memcmp(digest, ref, MD5_DIGEST_SIZE) == 0);
+    }
+  }
+
+  // multi-buffer matches single buffer, for any number of buffers
+  for(size_t n : {size_t(0), size_t(1), size_t(5), bufs.size()}) {
+    std::vector<const void*> ptrs;
+    std::vector<size_t> lens;
+    for(size_t ii = 0; ii < n; ++ii) {
+      ptrs.push_back(bufs[ii].data());
+      lens.push_back(bufs[ii].size());
+    }
+    std::vector<uint8_t> digests(n*MD5_DIGEST_SIZE);
+    MD5_multi(int(n), ptrs.data(), lens.data(), digests.data());
+    for(size_t ii = 0; ii < n; ++ii)
+      assert(memcmp(&digests[ii*MD5_DIGEST_SIZE], MD5(ptrs[ii], lens[ii], digest), MD5_DIGEST_SIZE) == 0);
+  }
+  printf("All tests passed\n");
+  if(argc > 1 && strcmp(argv[1], "--bench") == 0)
+    md5_bench();
+  return 0;
+}
 #endif
@@ -5,6 +5,12 @@
 // The block index is stored in the "extra" field of the gzip header which is supported by gzip and most other
 //  compression utlities, but not some other applications with incomplete gzip support.  Storing the index
 //  elsewhere, e.g., a separate file, is also possible.
+// The v2 format has 64-bit offsets and lengths and no limit on number of blocks; the index is stored in empty gzip
+//  members following the data (so the file is still valid gzip) or in a separate sidecar stream
+// Optional codecs, selected at compile time (miniz is always used for streaming and bgz deflate blocks):
+//  - MINIZ_GZ_USE_LIBDEFLATE: use libdeflate for in-memory gzip()/gunzip() (whole buffer only)
+//  - MINIZ_GZ_USE_ZSTD: support zstd blocks in bgz container (bgz_write_parallel() w/ MINIZ_GZ_ZSTD level
+//    flag); these files have index subfield id "SZ" and are not valid gzip, so must be read w/ BgzReader
 
 #ifndef MINIZ_GZIP_H
 #define MINIZ_GZIP_H
@@ -35,7 +41,11 @@ static void stream_seek(long offset, int origin, void* ctx)
   long offsetg = origin == SEEK_SET ? offset : offset + s->tellg();
   long offsetp = origin == SEEK_SET ? offset : offset + s->tellp();
   s->seekg(offsetg, std::ios_base::beg);
+  bool ok = !s->fail();
   s->seekp(offsetp, std::ios_base::beg);
+  // put position can be invalid, e.g., for stringstream constructed from string or written before reading
+  if(ok && s->fail())
+    s->clear();
 }
 #endif
 
@@ -45,37 +55,86 @@ struct minigz_io_t
   typedef size_t (*read_fn_t)(void*, size_t, void*);  // dest, bytes, ctx -- read from stream to dest
   typedef size_t (*write_fn_t)(const void*, size_t, void*);  // src, bytes, ctx -- write src to stream
   typedef void (*seek_fn_t)(long, int, void*);  // offset, origin (SEEK_SET or SEEK_CUR), ctx
+  // optional: sets *dest to up to bytes of data owned by stream (valid until next read) to avoid a copy
+  typedef size_t (*readp_fn_t)(void**, size_t, void*);  // dest, bytes, ctx
+  // optional: truncate stream to length bytes (used by BgzWriter)
+  typedef bool (*truncate_fn_t)(size_t, void*);  // length, ctx
 
 #ifdef __cplusplus
   minigz_io_t(std::iostream& strm) : ctx(&strm), read(stream_read), write(stream_write), seek(stream_seek) {}
-  minigz_io_t(void* _ctx, read_fn_t _read, write_fn_t _write, seek_fn_t _seek)
-    : ctx(_ctx), read(_read), write(_write), seek(_seek) {}
+  minigz_io_t(void* _ctx, read_fn_t _read, write_fn_t _write, seek_fn_t _seek, readp_fn_t _readp = NULL)
+    : ctx(_ctx), read(_read), write(_write), seek(_seek), readp(_readp) {}
   // should be able to drop 'explicit', at least if we do some template magic
   template<typename T>
-  explicit minigz_io_t(T& t) : minigz_io_t((void*)&t, T::readfn, T::writefn, T::seekfn) {}
+  explicit minigz_io_t(T& t) : minigz_io_t((void*)&t, T::readfn, T::writefn, T::seekfn, get_readp<T>(0))
+    { truncate = get_truncate<T>(0); }
+
+  // use T::readpfn, T::truncatefn if present
+  template<typename T> static auto get_readp(int) -> decltype(&T::readpfn) { return &T::readpfn; }
+  template<typename T> static readp_fn_t get_readp(long) { return NULL; }
+  template<typename T> static auto get_truncate(int) -> decltype(&T::truncatefn) { return &T::truncatefn; }
+  template<typename T> static truncate_fn_t get_truncate(long) { return NULL; }
 #endif
   void* ctx;
   read_fn_t read;
   write_fn_t write;
   seek_fn_t seek;
+  readp_fn_t readp = NULL;
+  truncate_fn_t truncate = NULL;
 };
 
 typedef minigz_io_t minigz_in_t;
 typedef minigz_io_t minigz_out_t;
 
 
+// reusable (de)compressor state and buffers - init and allocation for each call otherwise dominates time
+//  for small inputs; not thread safe, so use one per thread
+struct minigz_ctx_t
+{
+  minigz_ctx_t() {}
+  ~minigz_ctx_t();
+  minigz_ctx_t(const minigz_ctx_t&) = delete;
+  minigz_ctx_t& operator=(const minigz_ctx_t&) = delete;
+
+  void* deflate_strm = NULL;  // mz_stream*
+  void* inflate_strm = NULL;
+  int deflate_level = -1;
+  uint8_t* buffers = NULL;
+  size_t buffers_size = 0;
+  void* ld_compressor = NULL;  // libdeflate state for MINIZ_GZ_USE_LIBDEFLATE
+  void* ld_decompressor = NULL;
+  int ld_level = -1;
+};
+
 // return value is number of bytes written to output stream (or < 0 if error)
-int gzip(minigz_in_t istrm, minigz_out_t ostrm, int level = 6);  //MZ_DEFAULT_LEVEL = 6
-int gunzip(minigz_in_t istrm, minigz_out_t ostrm);
+int gzip(minigz_in_t istrm, minigz_out_t ostrm, int level = 6, minigz_ctx_t* ctx = NULL);  //MZ_DEFAULT_LEVEL = 6
+int gunzip(minigz_in_t istrm, minigz_out_t ostrm, minigz_ctx_t* ctx = NULL);
+
+// in-memory gzip and gunzip directly between buffers, w/o copying through chunk buffers; return number of
+//  bytes written to dest or < 0 on error (including dest too small)
+// gzip_bound() gives max compressed size; gunzip_size() gives uncompressed size from gzip footer (ISIZE, which
+//  is uncompressed size mod 2^32, so only valid for single member gzip data < 4GB, e.g., not v2 block gzip)
+size_t gzip_bound(size_t srclen);
+size_t gunzip_size(const void* src, size_t srclen);
+int gzip(const void* src, size_t srclen, void* dest, size_t destlen, int level = 6, minigz_ctx_t* ctx = NULL);
+int gunzip(const void* src, size_t srclen, void* dest, size_t destlen, minigz_ctx_t* ctx = NULL);
 
 // lower level fns
 #define MINIZ_GZ_CRC32_INIT (0)
 #define MINIZ_GZ_NO_FINISH 0x00010000
-int miniz_go(int level, minigz_in_t istrm, minigz_out_t ostrm, uint32_t* crc_32 = NULL, size_t max_read_bytes = SIZE_MAX);
+#define MINIZ_GZ_ZSTD 0x00020000  // for bgz_write_parallel() - zstd blocks (w/ zstd level)
+#define MINIZ_GZ_BGZ_V2 0x00040000  // for bgz_write_parallel() - write v2 index
+int miniz_go(int level, minigz_in_t istrm, minigz_out_t ostrm, uint32_t* crc_32 = NULL,
+    size_t max_read_bytes = SIZE_MAX, minigz_ctx_t* ctx = NULL);
 void gzip_header(minigz_out_t ostrm, uint8_t flags = 0);
 void gzip_footer(minigz_out_t ostrm, int len, uint32_t crc32);
+// crc32 (same as mz_crc32) using PCLMULQDQ (x86) or PMULL (ARM) if available, slicing-by-8 otherwise
+uint32_t miniz_crc32(uint32_t crc, const void* buf, size_t len);
+// crc32 of A+B given crc32 of A, crc32 of B, and length of B
+uint32_t miniz_crc32_combine(uint32_t crc1, uint32_t crc2, size_t len2);
 
 #include <vector>
+#include <memory>
 
 struct bgz_block_info_t
 {
@@ -85,46 +144,439 @@ struct bgz_block_info_t
   uint32_t reserved;
 };
 
+// block codec - value is 2nd byte of index subfield id
+enum bgz_codec_t { BGZ_DEFLATE = 'L', BGZ_ZSTD = 'Z' };
+
 void bgz_header(minigz_out_t ostrm, uint16_t n);
-void bgz_write_index(minigz_out_t ostrm, bgz_block_info_t* data, size_t count);
-std::vector<bgz_block_info_t> bgz_get_index(minigz_in_t istrm);
+void bgz_write_index(minigz_out_t ostrm, bgz_block_info_t* data, size_t count, bgz_codec_t codec = BGZ_DEFLATE);
+// only deflate index is returned if codec is NULL
+std::vector<bgz_block_info_t> bgz_get_index(minigz_in_t istrm, bgz_codec_t* codec = NULL);
 bool bgz_read_block(minigz_in_t istrm, bgz_block_info_t* block_info, minigz_out_t ostrm);
 
+// v2 index entry (24 bytes on disk: offset, len_cum, crc32_cum, reserved)
+struct bgz_block_info64_t
+{
+  uint64_t offset;
+  uint64_t len_cum;
+  uint32_t crc32_cum;
+  uint32_t reserved;
+};
+
+#define BGZ2_HEADER_EXTRA 20  // pass to bgz_header() for v2 file
+// write v2 index to ostrm at pos (just past gzip footer) or to sidecar, and index location to v2 header;
+//  returns size of index in bytes
+size_t bgz2_write_index(minigz_out_t ostrm, uint64_t pos, const bgz_block_info64_t* data, size_t count,
+    bgz_codec_t codec = BGZ_DEFLATE, minigz_out_t* sidecar = NULL);
+// read v1 or v2 index; sidecar is required for v2 file w/ separate index
+std::vector<bgz_block_info64_t> bgz_get_index64(minigz_in_t istrm, bgz_codec_t* codec = NULL,
+    minigz_in_t* sidecar = NULL);
+// returns 1 or 2 for bgz file (any codec), 0 otherwise
+int bgz_version(minigz_in_t istrm);
+bool bgz_read_block(minigz_in_t istrm, bgz_block_info64_t* block_info, minigz_out_t ostrm);
+
+// write block gzip file w/ blocks of block_size uncompressed bytes, compressing up to nthreads blocks at once
+//  (nthreads <= 0 for hardware concurrency); output is identical to writing each block w/ miniz_go(); header
+//  has space for index of max_blocks blocks (max 4094) unless MINIZ_GZ_BGZ_V2 is set in level, in which case
+//  max_blocks is ignored; returns uncompressed length or < 0 on error
+int64_t bgz_write_parallel(minigz_in_t istrm, minigz_out_t ostrm, size_t block_size, int level = 6,
+    int nthreads = 0, size_t max_blocks = 1022);
+
+// adaptive block gzip: before compressing each block, a few samples are deflated at level 1 and, if estimated
+//  ratio (compressed/uncompressed) exceeds store_ratio, block is stored w/ level 0; uncompressed size of each
+//  block is chosen from ratio of previous blocks so that compressed size approaches target_size (the amount
+//  of data read for a random access), within [min_block, max_block]
+struct bgz_adaptive_t
+{
+  int level = 6;  // may include MINIZ_GZ_BGZ_V2
+  size_t max_blocks = 1022;  // ignored for v2
+  size_t target_size = 1 << 16;
+  size_t min_block = 1 << 12;
+  size_t max_block = 1 << 22;
+  size_t sample_size = 4096;  // total bytes sampled per block (from start, middle, and end)
+  double store_ratio = 0.9;
+};
+
+struct bgz_block_stats_t
+{
+  uint64_t len;  // uncompressed size
+  uint64_t comp_len;
+  float sample_ratio;  // estimated ratio from samples
+  int level;  // 0 if stored
+  double ratio() const { return len ? double(comp_len)/len : 0; }
+};
+
+// returns uncompressed length or < 0 on error; if stats is not NULL, info for each block is appended
+int64_t bgz_write_adaptive(minigz_in_t istrm, minigz_out_t ostrm, const bgz_adaptive_t& opts,
+    std::vector<bgz_block_stats_t>* stats = NULL);
+
+// modify block gzip file in place: open() reads index of existing file, truncate(n) discards all blocks after
+//  the first n (using stored cumulative crc and length), write() appends a block, close() writes final empty
+//  block, footer, and index; if the last block of an existing file was written w/ MZ_FINISH (e.g. by
+//  bgz_write_parallel), write() first recompresses it w/ MZ_FULL_FLUSH
+// strm must support read, write, and seek; if it has no truncate fn, file will not shrink (any trailing data
+//  after gzip footer is ignored by gunzip and BgzReader); if sidecar is set, v2 index is written to it
+//  instead of the end of strm
+class BgzWriter
+{
+public:
+  BgzWriter(const minigz_io_t& _strm, int _level = 6, minigz_io_t* _sidecar = NULL)
+    : strm(_strm), sidecar(_sidecar), level(_level) {}
+  // start new file w/ header space for index of maxBlocks blocks (max 4094)
+  bool create(size_t _maxBlocks = 1022);
+  // start new v2 file (no limit on number of blocks)
+  bool createV2();
+  // read index of existing v1 or v2 file; returns false if not a deflate bgz file
+  bool open();
+  bool truncate(size_t nblocks);
+  bool write(const void* data, size_t len);
+  bool close();
+  size_t numBlocks() const { return index.empty() ? 0 : index.size() - 1; }
+  uint64_t size() const { return index.empty() ? 0 : index.back().len_cum; }
+  size_t maxBlocks() const { return maxBlks; }
+  bool isV2() const { return v2; }
+  const std::vector<bgz_block_info64_t>& blockIndex() const { return index; }
+
+private:
+  minigz_io_t strm;
+  minigz_io_t* sidecar;
+  int level;
+  size_t maxBlks = 0;
+  bool v2 = false;
+  bool lastFinal = false;  // last block written w/ MZ_FINISH
+  std::vector<bgz_block_info64_t> index;
+  minigz_ctx_t ctx;
+};
+
+// random access reader for block gzip file: read() returns data at any offset in uncompressed data, inflating
+//  only the blocks needed; most recently used blocks are cached and, if nthreads > 1, blocks following those
+//  read sequentially are inflated in the background; not thread safe (inflation runs on internal threads)
+// v1 and v2 files are supported; sidecar is only needed for v2 file w/ separate index
+class ThreadPool;
+
+class BgzReader
+{
+public:
+  BgzReader(const minigz_in_t& _istrm, size_t _maxCached = 8, int nthreads = 1, minigz_in_t* sidecar = NULL);
+  ~BgzReader();
+  bool isValid() const { return index.size() > 1; }
+  uint64_t size() const { return isValid() ? index.back().len_cum : 0; }
+  size_t numBlocks() const { return isValid() ? index.size() - 1 : 0; }
+  const std::vector<bgz_block_info64_t>& blockIndex() const { return index; }
+  bgz_codec_t blockCodec() const { return codec; }
+  // read up to len bytes from uncompressed offset into dest; returns bytes read or < 0 on error
+  int64_t read(uint64_t offset, size_t len, void* dest);
+  // start reading and inflating blocks covering [offset, offset + len) (as many as fit in cache)
+  void prefetch(uint64_t offset, size_t len);
+
+private:
+  struct Block;
+  minigz_in_t istrm;
+  bgz_codec_t codec = BGZ_DEFLATE;
+  std::vector<bgz_block_info64_t> index;
+  std::vector< std::unique_ptr<Block> > cache;
+  minigz_ctx_t ctx;  // inflate stream for blocks read w/o pool
+  size_t maxCached;
+  size_t nCached = 0;
+  size_t readAhead;
+  size_t lastBlock = SIZE_MAX;
+  uint64_t useCount = 0;
+  std::unique_ptr<ThreadPool> pool;
+
+  size_t findBlock(uint64_t offset) const;
+  Block* fetchBlock(size_t idx);
+  const Block* getBlock(size_t idx);
+};
+
+// push-style gzip (level >= 0) or gunzip (level < 0): feed() data as it becomes available and output is written
+//  to sink whenever internal buffer of bufSize bytes fills (so sink sees writes of at most bufSize bytes);
+//  flush() writes pending output, w/ MZ_FULL_FLUSH when compressing so that all data fed so far can be
+//  decompressed; finish() writes (gzip) or checks (gunzip) footer - data fed after end of gzip member is ignored
+// if ctx is passed, its stream is used, so ctx must not be used for anything else until finish()
+class GzipStream
+{
+public:
+  GzipStream(const minigz_out_t& _sink, int _level = 6, size_t bufSize = 1 << 16, minigz_ctx_t* _ctx = NULL);
+  ~GzipStream();
+  bool feed(const void* data, size_t len);
+  bool flush();
+  bool finish();
+  bool isError() const { return state == GZ_ERROR; }
+  bool isDone() const { return state == GZ_DONE; }
+  uint64_t totalIn() const { return nIn; }
+  uint64_t totalOut() const { return nOut; }  // includes output not yet written to sink
+  uint32_t crc() const { return crc_32; }  // crc32 of uncompressed data so far
+
+private:
+  enum State { GZ_HEADER, GZ_DATA, GZ_FOOTER, GZ_DONE, GZ_ERROR };
+  minigz_out_t sink;
+  int level;
+  minigz_ctx_t* ctx;
+  void* strm = NULL;  // mz_stream
+  std::vector<uint8_t> buf;
+  size_t nbuf = 0;
+  std::vector<uint8_t> partial;  // incomplete header or footer when decompressing
+  uint32_t crc_32 = MINIZ_GZ_CRC32_INIT;
+  uint64_t nIn = 0, nOut = 0;
+  State state = GZ_HEADER;
+
+  bool run(const uint8_t* data, size_t len, int flush);
+  bool writeBuf();
+};
+
 #endif  // MINIZ_GZIP_H
 
 #ifdef MINIZ_GZ_IMPLEMENTATION
 #undef MINIZ_GZ_IMPLEMENTATION
 #include "miniz/miniz.h"
 #include <memory>
+#ifdef MINIZ_GZ_USE_LIBDEFLATE
+#include <libdeflate.h>
+#endif
+#ifdef MINIZ_GZ_USE_ZSTD
+#include <zstd.h>
+#endif
+#include <deque>
+#include "threadutil.h"
 
 //static constexpr size_t STRM_MAX = std::numeric_limits<std::streamsize>::max();
 static size_t chunkSize = 1 << 20;
 
+// crc32
+// slicing-by-8: process 8 bytes per step w/ 8 tables - table[k][b] is crc of byte b followed by k zero bytes
+static const uint32_t* crc32_tables()
+{
+  static struct CRC32Tables {
+    uint32_t t[8][256];
+    CRC32Tables() {
+      for(uint32_t ii = 0; ii < 256; ++ii) {
+        uint32_t c = ii;
+        for(int jj = 0; jj < 8; ++jj)
+          c = c & 1 ? (c >> 1) ^ 0xEDB88320 : c >> 1;
+        t[0][ii] = c;
+      }
+      for(int kk = 1; kk < 8; ++kk) {
+        for(int ii = 0; ii < 256; ++ii)
+          t[kk][ii] = (t[kk-1][ii] >> 8) ^ t[0][t[kk-1][ii] & 0xFF];
+      }
+    }
+  } tables;
+  return &tables.t[0][0];
+}
+
+static uint32_t crc32_slice8(uint32_t crc, const uint8_t* p, size_t len)
+{
+  const uint32_t* t = crc32_tables();
+  crc = ~crc;
+  for(; len >= 8; p += 8, len -= 8) {
+    uint32_t a = (p[0] | (p[1] << 8) | (p[2] << 16) | (uint32_t(p[3]) << 24)) ^ crc;
+    uint32_t b = p[4] | (p[5] << 8) | (p[6] << 16) | (uint32_t(p[7]) << 24);
+    crc = t[7*256 + (a & 0xFF)] ^ t[6*256 + ((a >> 8) & 0xFF)] ^ t[5*256 + ((a >> 16) & 0xFF)] ^ t[4*256 + (a >> 24)]
+        ^ t[3*256 + (b & 0xFF)] ^ t[2*256 + ((b >> 8) & 0xFF)] ^ t[1*256 + ((b >> 16) & 0xFF)] ^ t[b >> 24];
+  }
+  for(; len > 0; --len)
+    crc = t[(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+  return ~crc;
+}
+
+// carry-less multiply folding - Ref: Intel "Fast CRC Computation for Generic Polynomials Using PCLMULQDQ
+//  Instruction" and Chromium zlib crc32_simd.c; minimal 128-bit vector wrappers let x86 and ARM share code
+#if defined(__PCLMUL__) && defined(__SSE2__)
+#include <wmmintrin.h>
+#define CRC32_FOLD 1
+typedef __m128i crcv_t;
+static inline crcv_t crcv_load(const uint8_t* p) { return _mm_loadu_si128((const __m128i*)p); }
+static inline crcv_t crcv_set(uint64_t lo, uint64_t hi) { return _mm_set_epi64x(hi, lo); }
+static inline crcv_t crcv_xor(crcv_t a, crcv_t b) { return _mm_xor_si128(a, b); }
+static inline crcv_t crcv_and(crcv_t a, crcv_t b) { return _mm_and_si128(a, b); }
+static inline crcv_t crcv_mul00(crcv_t a, crcv_t b) { return _mm_clmulepi64_si128(a, b, 0x00); }  // a.lo*b.lo
+static inline crcv_t crcv_mul11(crcv_t a, crcv_t b) { return _mm_clmulepi64_si128(a, b, 0x11); }  // a.hi*b.hi
+static inline crcv_t crcv_mul01(crcv_t a, crcv_t b) { return _mm_clmulepi64_si128(a, b, 0x10); }  // a.lo*b.hi
+static inline crcv_t crcv_shr4(crcv_t a) { return _mm_srli_si128(a, 4); }  // shift right by bytes
+static inline crcv_t crcv_shr8(crcv_t a) { return _mm_srli_si128(a, 8); }
+static inline uint32_t crcv_get1(crcv_t a) { return _mm_cvtsi128_si32(_mm_srli_si128(a, 4)); }  // 32-bit lane 1
+#elif defined(__aarch64__) && (defined(__ARM_FEATURE_CRYPTO) || defined(__ARM_FEATURE_AES))
+#include <arm_neon.h>
+#define CRC32_FOLD 1
+typedef uint64x2_t crcv_t;
+static inline crcv_t crcv_load(const uint8_t* p) { return vreinterpretq_u64_u8(vld1q_u8(p)); }
+static inline crcv_t crcv_set(uint64_t lo, uint64_t hi) { return vcombine_u64(vcreate_u64(lo), vcreate_u64(hi)); }
+static inline crcv_t crcv_xor(crcv_t a, crcv_t b) { return veorq_u64(a, b); }
+static inline crcv_t crcv_and(crcv_t a, crcv_t b) { return vandq_u64(a, b); }
+static inline crcv_t crcv_pmull(uint64_t a, uint64_t b) { return vreinterpretq_u64_p128(vmull_p64(a, b)); }
+static inline crcv_t crcv_mul00(crcv_t a, crcv_t b) { return crcv_pmull(vgetq_lane_u64(a, 0), vgetq_lane_u64(b, 0)); }
+static inline crcv_t crcv_mul11(crcv_t a, crcv_t b) { return crcv_pmull(vgetq_lane_u64(a, 1), vgetq_lane_u64(b, 1)); }
+static inline crcv_t crcv_mul01(crcv_t a, crcv_t b) { return crcv_pmull(vgetq_lane_u64(a, 0), vgetq_lane_u64(b, 1)); }
+static inline crcv_t crcv_shr4(crcv_t a)
+  { return vreinterpretq_u64_u8(vextq_u8(vreinterpretq_u8_u64(a), vdupq_n_u8(0), 4)); }
+static inline crcv_t crcv_shr8(crcv_t a)
+  { return vreinterpretq_u64_u8(vextq_u8(vreinterpretq_u8_u64(a), vdupq_n_u8(0), 8)); }
+static inline uint32_t crcv_get1(crcv_t a) { return vgetq_lane_u32(vreinterpretq_u32_u64(a), 1); }
+#endif
+
+#ifdef CRC32_FOLD
+// len must be >= 64 and a multiple of 16; crc is not pre/post-inverted
+static uint32_t crc32_fold(uint32_t crc, const uint8_t* p, size_t len)
+{
+  const crcv_t k1k2 = crcv_set(0x0154442bd4, 0x01c6e41596);  // x^(4*128+32) mod P, x^(4*128-32) mod P
+  const crcv_t k3k4 = crcv_set(0x01751997d0, 0x00ccaa009e);  // x^(128+32) mod P, x^(128-32) mod P
+  const crcv_t k5k0 = crcv_set(0x0163cd6124, 0);  // x^64 mod P
+  const crcv_t poly = crcv_set(0x01db710641, 0x01f7011641);  // P, Barrett constant mu
+  const crcv_t mask32 = crcv_set(0xFFFFFFFF, 0xFFFFFFFF);
+
+  // fold 4 x 128 bits in parallel
+  crcv_t x1 = crcv_xor(crcv_load(p), crcv_set(crc, 0));
+  crcv_t x2 = crcv_load(p + 16);
+  crcv_t x3 = crcv_load(p + 32);
+  crcv_t x4 = crcv_load(p + 48);
+  for(p += 64, len -= 64; len >= 64; p += 64, len -= 64) {
+    x1 = crcv_xor(crcv_xor(crcv_mul00(x1, k1k2), crcv_mul11(x1, k1k2)), crcv_load(p));
+    x2 = crcv_xor(crcv_xor(crcv_mul00(x2, k1k2), crcv_mul11(x2, k1k2)), crcv_load(p + 16));
+    x3 = crcv_xor(crcv_xor(crcv_mul00(x3, k1k2), crcv_mul11(x3, k1k2)), crcv_load(p + 32));
+    x4 = crcv_xor(crcv_xor(crcv_mul00(x4, k1k2), crcv_mul11(x4, k1k2)), crcv_load(p + 48));
+  }
+  // fold to 128 bits, then remaining 16 byte blocks
+  x1 = crcv_xor(crcv_xor(crcv_mul00(x1, k3k4), crcv_mul11(x1, k3k4)), x2);
+  x1 = crcv_xor(crcv_xor(crcv_mul00(x1, k3k4), crcv_mul11(x1, k3k4)), x3);
+  x1 = crcv_xor(crcv_xor(crcv_mul00(x1, k3k4), crcv_mul11(x1, k3k4)), x4);
+  for(; len >= 16; p += 16, len -= 16)
+    x1 = crcv_xor(crcv_xor(crcv_mul00(x1, k3k4), crcv_mul11(x1, k3k4)), crcv_load(p));
+  // fold 128 to 64 bits
+  x1 = crcv_xor(crcv_shr8(x1), crcv_mul01(x1, k3k4));
+  x1 = crcv_xor(crcv_mul00(crcv_and(x1, mask32), k5k0), crcv_shr4(x1));
+  // Barrett reduction to 32 bits
+  crcv_t x2b = crcv_mul01(crcv_and(x1, mask32), poly);
+  x2b = crcv_mul00(crcv_and(x2b, mask32), poly);
+  return crcv_get1(crcv_xor(x1, x2b));
+}
+#endif
+
+uint32_t miniz_crc32(uint32_t crc, const void* buf, size_t len)
+{
+  const uint8_t* p = (const uint8_t*)buf;
+#ifdef CRC32_FOLD
+  if(len >= 64) {
+    size_t n = len & ~size_t(15);
+    crc = ~crc32_fold(~crc, p, n);
+    p += n;
+    len -= n;
+  }
+#endif
+  return crc32_slice8(crc, p, len);
+}
+
+// multiply polynomials a and b modulo crc32 polynomial (reflected bit order, x^0 is MSB)
+static uint32_t crc32_multmodp(uint32_t a, uint32_t b)
+{
+  uint32_t m = 1u << 31, p = 0;
+  for(;;) {
+    if(a & m) {
+      p ^= b;
+      if((a & (m - 1)) == 0) break;
+    }
+    m >>= 1;
+    b = b & 1 ? (b >> 1) ^ 0xEDB88320 : b >> 1;
+  }
+  return p;
+}
+
+// Ref: zlib crc32_combine - crc1 * x^(8*len2) mod P, w/ x^(8*2^k) obtained by repeated squaring
+uint32_t miniz_crc32_combine(uint32_t crc1, uint32_t crc2, size_t len2)
+{
+  uint32_t p = 1u << 31, sq = 1u << 23;  // x^0, x^8
+  for(; len2; len2 >>= 1, sq = crc32_multmodp(sq, sq)) {
+    if(len2 & 1)
+      p = crc32_multmodp(sq, p);
+  }
+  return crc32_multmodp(p, crc1) ^ crc2;
+}
+
+static int miniz_init(mz_stream* s, int level)
+{
+  memset(s, 0, sizeof(mz_stream));
+  return level < 0 ? inflateInit2(s, -MZ_DEFAULT_WINDOW_BITS) :
+      deflateInit2(s, level, MZ_DEFLATED, -MZ_DEFAULT_WINDOW_BITS, 6, MZ_DEFAULT_STRATEGY);
+}
+
+minigz_ctx_t::~minigz_ctx_t()
+{
+  if(deflate_strm) { deflateEnd((mz_stream*)deflate_strm); delete (mz_stream*)deflate_strm; }
+  if(inflate_strm) { inflateEnd((mz_stream*)inflate_strm); delete (mz_stream*)inflate_strm; }
+  free(buffers);
+#ifdef MINIZ_GZ_USE_LIBDEFLATE
+  libdeflate_free_compressor((libdeflate_compressor*)ld_compressor);
+  libdeflate_free_decompressor((libdeflate_decompressor*)ld_decompressor);
+#endif
+}
+
+// get stream from context - reset if already created for level, otherwise (re)initialize
+static mz_stream* miniz_ctx_stream(minigz_ctx_t* ctx, int level)
+{
+  mz_stream* s = (mz_stream*)(level < 0 ? ctx->inflate_strm : ctx->deflate_strm);
+  if(s) {
+    if(level < 0)
+      return inflateReset(s) == MZ_OK ? s : NULL;
+    // changing level w/ deflateParams is not supported by miniz, so recreate
+    if(level == ctx->deflate_level)
+      return deflateReset(s) == MZ_OK ? s : NULL;
+    deflateEnd(s);
+  }
+  else
+    s = new mz_stream;
+  int err = miniz_init(s, level);
+  if(level < 0)
+    ctx->inflate_strm = err ? NULL : s;
+  else {
+    ctx->deflate_strm = err ? NULL : s;
+    ctx->deflate_level = level;
+  }
+  if(err) delete s;
+  return err ? NULL : s;
+}
+
 // Ref: https://github.com/strake/gzip/blob/master/gzip.c
 // level < 0 to inflate, level >= 0 to deflate
 // returns number of uncompressed bytes (written if inflate, read if deflate) or < 0 on error
-int miniz_go(int level, minigz_in_t istrm, minigz_out_t ostrm, uint32_t* crc_32, size_t max_read_bytes)
+int miniz_go(int level, minigz_in_t istrm, minigz_out_t ostrm, uint32_t* crc_32, size_t max_read_bytes, minigz_ctx_t* ctx)
 {
   int res = -1;  // -1 indicates error
   int final_flush = level & MINIZ_GZ_NO_FINISH ? MZ_FULL_FLUSH : MZ_FINISH;
   level = level & ~MINIZ_GZ_NO_FINISH;
 
-  mz_stream s;
-  memset(&s, 0, sizeof(mz_stream));
-  int initerr = level < 0 ?
-      inflateInit2(&s, -MZ_DEFAULT_WINDOW_BITS) :
-      deflateInit2(&s, level, MZ_DEFLATED, -MZ_DEFAULT_WINDOW_BITS, 6, MZ_DEFAULT_STRATEGY);
-  if(initerr) return -1;
-
-  uint8_t* x = (uint8_t*)malloc(chunkSize);
-  uint8_t* y = (uint8_t*)malloc(chunkSize);
+  mz_stream local;
+  mz_stream* ps = ctx ? miniz_ctx_stream(ctx, level) : &local;
+  if(!ps || (!ctx && miniz_init(ps, level))) return -1;
+  mz_stream& s = *ps;
+  s.next_in = NULL;  // reset does not clear input
+  s.avail_in = 0;
+
+  uint8_t *x, *y;  // x is not used if istrm supports readp
+  if(ctx) {
+    if(ctx->buffers_size != chunkSize) {
+      free(ctx->buffers);
+      ctx->buffers = (uint8_t*)malloc(2*chunkSize);
+      ctx->buffers_size = chunkSize;
+    }
+    x = ctx->buffers;
+    y = ctx->buffers + chunkSize;
+  }
+  else {
+    x = istrm.readp ? NULL : (uint8_t*)malloc(chunkSize);
+    y = (uint8_t*)malloc(chunkSize);
+  }
 
   size_t n = 0, nout = 0, nreq = chunkSize;
   for(;;) {
     if(s.avail_in == 0) {
       size_t reqlim = max_read_bytes - s.total_in;
-      n = istrm.read(x, reqlim < nreq ? reqlim : nreq, istrm.ctx);
-      s.next_in = x;
+      if(istrm.readp) {
+        void* p = NULL;
+        n = istrm.readp(&p, reqlim < nreq ? reqlim : nreq, istrm.ctx);
+        s.next_in = (uint8_t*)p;
+      }
+      else {
+        n = istrm.read(x, reqlim < nreq ? reqlim : nreq, istrm.ctx);
+        s.next_in = x;
+      }
       s.avail_in = n;
     }
     s.next_out = y;
@@ -140,7 +592,7 @@ int miniz_go(int level, minigz_in_t istrm, minigz_out_t ostrm, uint32_t* crc_32,
       if(ostrm.write(y, nout, ostrm.ctx) != nout)
         goto error;  //return -1;  // abort on write error
       if(level < 0) {  // inflate
-        if(crc_32) *crc_32 = mz_crc32(*crc_32, y, chunkSize - s.avail_out);
+        if(crc_32) *crc_32 = miniz_crc32(*crc_32, y, chunkSize - s.avail_out);
         if(res == MZ_STREAM_END) {  //|| (n < nreq && s.avail_out > 0)) { -- check moved to BUF_ERROR case
           if(s.avail_in > 0) {
             //istrm.clear();  // seekg clears eofbit, but doesn't set goodbit, so it fails if at end!
@@ -150,7 +602,7 @@ int miniz_go(int level, minigz_in_t istrm, minigz_out_t ostrm, uint32_t* crc_32,
         }
       }
       else {  // deflate
-        if(crc_32) *crc_32 = mz_crc32(*crc_32, next_in, s.next_in - next_in);
+        if(crc_32) *crc_32 = miniz_crc32(*crc_32, next_in, s.next_in - next_in);
         if(res == MZ_STREAM_END || (n < nreq && s.avail_out > 0))  // 2nd case is for SYNC_FLUSH
           goto done;  //return s.total_in;
       }
@@ -169,8 +621,10 @@ int miniz_go(int level, minigz_in_t istrm, minigz_out_t ostrm, uint32_t* crc_32,
 done:
   res = level < 0 ? s.total_out : s.total_in;
 error:
-  free(y); free(x);
-  level < 0 ? inflateEnd(&s) : deflateEnd(&s);
+  if(!ctx) {
+    free(y); free(x);
+    level < 0 ? inflateEnd(&s) : deflateEnd(&s);
+  }
   return res;
 }
 
@@ -185,7 +639,7 @@ static void skipString(minigz_in_t istrm)
   while(istrm.read(&c, 1, istrm.ctx) == 1 && c != '\0') {}
 }
 
-int gunzip(minigz_in_t istrm, minigz_out_t ostrm)
+int gunzip(minigz_in_t istrm, minigz_out_t ostrm, minigz_ctx_t* ctx)
 {
   uint8_t x[10];
   if(istrm.read(x, 10, istrm.ctx) != 10) return -1;  // , "not in gz format");
@@ -201,7 +655,7 @@ int gunzip(minigz_in_t istrm, minigz_out_t ostrm)
   if(x[3] & 1 << 4) skipString(istrm);  // FCOMMENT
   if(x[3] & 1 << 1) istrm.read(c, 2, istrm.ctx); // FCRC - header checksum (2 bytes)
   uint32_t crc_32 = MZ_CRC32_INIT;
-  int len = miniz_go(-1, istrm, ostrm, &crc_32);  // level < 0 requests decompression
+  int len = miniz_go(-1, istrm, ostrm, &crc_32, SIZE_MAX, ctx);  // level < 0 requests decompression
   uint8_t crc_calc[4];
   storLE32(crc_calc, crc_32);
   uint8_t crc_gzip[4];
@@ -231,11 +685,11 @@ void gzip_footer(minigz_out_t ostrm, int len, uint32_t crc_32)
   ostrm.write(ftr, 8, ostrm.ctx);  //write(ofd, ftr, 8);
 }
 
-int gzip(minigz_in_t istrm, minigz_out_t ostrm, int level)  //MZ_BEST_COMPRESSION
+int gzip(minigz_in_t istrm, minigz_out_t ostrm, int level, minigz_ctx_t* ctx)  //MZ_BEST_COMPRESSION
 {
   gzip_header(ostrm);
   uint32_t crc_32 = MZ_CRC32_INIT;
-  int len = miniz_go(level, istrm, ostrm, &crc_32);
+  int len = miniz_go(level, istrm, ostrm, &crc_32, SIZE_MAX, ctx);
   gzip_footer(ostrm, len, crc_32);
   return len;
 }
@@ -264,12 +718,12 @@ void bgz_header(minigz_out_t ostrm, uint16_t n)
   //ostrm << uint8_t(n) << uint8_t(n >> 8) << std::string(n, '\0');
 }
 
-void bgz_write_index(minigz_out_t ostrm, bgz_block_info_t* data, size_t count)
+void bgz_write_index(minigz_out_t ostrm, bgz_block_info_t* data, size_t count, bgz_codec_t codec)
 {
   ostrm.seek(12, SEEK_SET, ostrm.ctx);  // 10 bytes header + 2 bytes FEXTRA total length
   uint16_t n = count * sizeof(bgz_block_info_t);
 
-  uint8_t hdr[4] = { 'S', 'L', uint8_t(n), uint8_t(n >> 8) };
+  uint8_t hdr[4] = { 'S', uint8_t(codec), uint8_t(n), uint8_t(n >> 8) };
   ostrm.write(hdr, 4, ostrm.ctx);
   //ostrm << 'S' << 'L' << uint8_t(n) << uint8_t(n >> 8);
 
@@ -288,16 +742,143 @@ static uint32_t loadLE32(uint8_t* p)
   return p[0] | (p[1] << 8) | (p[2] << 16) | (p[3] << 24);
 }
 
+size_t gzip_bound(size_t srclen)
+{
+  size_t n = mz_deflateBound(NULL, srclen) + 18;  // 10 byte header + 8 byte footer
+#ifdef MINIZ_GZ_USE_LIBDEFLATE
+  n = std::max(n, libdeflate_gzip_compress_bound(NULL, srclen));
+#endif
+  return n;
+}
+
+size_t gunzip_size(const void* src, size_t srclen)
+{
+  return srclen < 18 ? 0 : loadLE32((uint8_t*)src + srclen - 4);
+}
+
+// returns size of gzip header or 0 if invalid
+// returns 0 if header is invalid or incomplete or not followed by at least tail bytes
+static size_t gzip_header_size(const uint8_t* x, size_t n, size_t tail = 8)
+{
+  if(n < 10 + tail || x[0] != 0x1F || x[1] != 0x8B || x[2] != 8) return 0;
+  size_t pos = 10;
+  if(x[3] & 1 << 2) pos = n < 12 ? n + 1 : pos + 2 + (x[10] << 0 | x[11] << 8);  // FEXTRA
+  if(x[3] & 1 << 3) { while(pos < n && x[pos]) ++pos; ++pos; }  // FNAME
+  if(x[3] & 1 << 4) { while(pos < n && x[pos]) ++pos; ++pos; }  // FCOMMENT
+  if(x[3] & 1 << 1) pos += 2;  // FCRC
+  return pos + tail <= n ? pos : 0;
+}
+
+static int gzip_mem_miniz(const void* src, size_t srclen, void* dest, size_t destlen, int level, minigz_ctx_t* ctx)
+{
+  if(destlen < 18 || srclen > INT_MAX) return -1;
+  mz_stream local;
+  mz_stream* s = ctx ? miniz_ctx_stream(ctx, level) : &local;
+  if(!s || (!ctx && miniz_init(s, level))) return -1;
+  uint8_t* out = (uint8_t*)dest;
+  uint8_t hdr[10] = { 0x1F, 0x8B, 8, 0, 0,0,0,0, 0, 0xFF };  // see gzip_header()
+  memcpy(out, hdr, 10);
+  s->next_in = (uint8_t*)src;
+  s->avail_in = srclen;
+  s->next_out = out + 10;
+  s->avail_out = destlen - 18;
+  int res = mz_deflate(s, MZ_FINISH);
+  size_t n = 10 + s->total_out;
+  if(!ctx) deflateEnd(s);
+  if(res != MZ_STREAM_END) return -1;
+  storLE32(out + n, miniz_crc32(MZ_CRC32_INIT, (const uint8_t*)src, srclen));
+  storLE32(out + n + 4, srclen);
+  return int(n + 8);
+}
+
+static int gunzip_mem_miniz(const void* src, size_t srclen, void* dest, size_t destlen, minigz_ctx_t* ctx)
+{
+  const uint8_t* in = (const uint8_t*)src;
+  size_t hdrlen = gzip_header_size(in, srclen);
+  if(!hdrlen) return -1;
+  destlen = std::min(destlen, size_t(INT_MAX));
+  mz_stream local;
+  mz_stream* s = ctx ? miniz_ctx_stream(ctx, -1) : &local;
+  if(!s || (!ctx && miniz_init(s, -1))) return -1;
+  s->next_in = (uint8_t*)in + hdrlen;
+  s->avail_in = srclen - hdrlen;
+  s->next_out = (uint8_t*)dest;
+  s->avail_out = destlen;
+  int res = mz_inflate(s, MZ_FINISH);
+  size_t n = s->total_out;
+  const uint8_t* ftr = in + hdrlen + s->total_in;
+  if(!ctx) inflateEnd(s);
+  if(res != MZ_STREAM_END || ftr + 8 > in + srclen) return -1;
+  if(loadLE32((uint8_t*)ftr) != miniz_crc32(MZ_CRC32_INIT, (const uint8_t*)dest, n) || loadLE32((uint8_t*)ftr + 4) != uint32_t(n))
+    return -1;
+  return int(n);
+}
+
+#ifdef MINIZ_GZ_USE_LIBDEFLATE
+static int gzip_mem_libdeflate(const void* src, size_t srclen, void* dest, size_t destlen, int level, minigz_ctx_t* ctx)
+{
+  if(srclen > INT_MAX) return -1;
+  libdeflate_compressor* c = ctx && ctx->ld_level == level ? (libdeflate_compressor*)ctx->ld_compressor : NULL;
+  if(!c) {
+    c = libdeflate_alloc_compressor(level);
+    if(ctx) {
+      libdeflate_free_compressor((libdeflate_compressor*)ctx->ld_compressor);
+      ctx->ld_compressor = c;
+      ctx->ld_level = c ? level : -1;
+    }
+  }
+  if(!c) return -1;
+  size_t n = libdeflate_gzip_compress(c, src, srclen, dest, destlen);
+  if(!ctx) libdeflate_free_compressor(c);
+  return n > 0 ? int(n) : -1;
+}
+
+static int gunzip_mem_libdeflate(const void* src, size_t srclen, void* dest, size_t destlen, minigz_ctx_t* ctx)
+{
+  libdeflate_decompressor* d = ctx ? (libdeflate_decompressor*)ctx->ld_decompressor : NULL;
+  if(!d) {
+    d = libdeflate_alloc_decompressor();
+    if(ctx) ctx->ld_decompressor = d;
+  }
+  if(!d) return -1;
+  size_t n = 0;
+  libdeflate_result res = libdeflate_gzip_decompress(d, src, srclen, dest, std::min(destlen, size_t(INT_MAX)), &n);
+  if(!ctx) libdeflate_free_decompressor(d);
+  return res == LIBDEFLATE_SUCCESS ? int(n) : -1;
+}
+#endif
+
+int gzip(const void* src, size_t srclen, void* dest, size_t destlen, int level, minigz_ctx_t* ctx)
+{
+#ifdef MINIZ_GZ_USE_LIBDEFLATE
+  return gzip_mem_libdeflate(src, srclen, dest, destlen, level, ctx);
+#else
+  return gzip_mem_miniz(src, srclen, dest, destlen, level, ctx);
+#endif
+}
+
+int gunzip(const void* src, size_t srclen, void* dest, size_t destlen, minigz_ctx_t* ctx)
+{
+#ifdef MINIZ_GZ_USE_LIBDEFLATE
+  return gunzip_mem_libdeflate(src, srclen, dest, destlen, ctx);
+#else
+  return gunzip_mem_miniz(src, srclen, dest, destlen, ctx);
+#endif
+}
+
 // TODO: return bgz_block_info_t* instead of std::vector and make sure this compiles as plain C
-std::vector<bgz_block_info_t> bgz_get_index(minigz_in_t istrm)
+std::vector<bgz_block_info_t> bgz_get_index(minigz_in_t istrm, bgz_codec_t* codec)
 {
   std::vector<bgz_block_info_t> res;
   uint8_t x[16];
   istrm.seek(0, SEEK_SET, istrm.ctx);
   if(istrm.read(x, 16, istrm.ctx) != 16 || x[0] != 0x1F || x[1] != 0x8B || x[2] != 8) // == 0x8B fails if x is char[]
     return res;  // not a valid gzip file
-  if(!(x[3] & 1 << 2) || (x[10] << 0 | x[11] << 8) < 4 || x[12] != 'S' || x[13] != 'L')
+  if(!(x[3] & 1 << 2) || (x[10] << 0 | x[11] << 8) < 4 || x[12] != 'S')
     return res;  // bgz header not present
+  if(x[13] != BGZ_DEFLATE && (!codec || x[13] != BGZ_ZSTD))
+    return res;  // unsupported codec
+  if(codec) *codec = bgz_codec_t(x[13]);
 
   size_t n = x[14] | (x[15] << 8);
   uint8_t* temp = new uint8_t[n];
@@ -319,6 +900,778 @@ bool bgz_read_block(minigz_in_t istrm, bgz_block_info_t* block_info, minigz_out_
   return crc_32 == block_info[1].crc32_cum;
 }
 
+// v2 format: header extra field has subfield "S2" w/ 16 bytes: index pos (u64), number of entries (u32), codec,
+//  flags (bit 0 set if index is in sidecar), 2 reserved bytes
+// index is stored as one or more empty gzip members, each w/ up to 2730 entries in extra subfield "SI", starting
+//  at index pos (just past footer of data member) or at start of sidecar
+#define BGZ2_MEMBER_ENTRIES 2730  // (65535 - 4)/24
+
+static void storLE64(uint8_t* p, uint64_t x)
+{
+  storLE32(p, uint32_t(x));
+  storLE32(p + 4, uint32_t(x >> 32));
+}
+
+static uint64_t loadLE64(uint8_t* p)
+{
+  return loadLE32(p) | uint64_t(loadLE32(p + 4)) << 32;
+}
+
+size_t bgz2_write_index(minigz_out_t ostrm, uint64_t pos, const bgz_block_info64_t* data, size_t count,
+    bgz_codec_t codec, minigz_out_t* sidecar)
+{
+  minigz_out_t& out = sidecar ? *sidecar : ostrm;
+  out.seek(sidecar ? 0 : long(pos), SEEK_SET, out.ctx);
+  size_t nbytes = 0;
+  uint8_t bytes[24];
+  for(size_t ii = 0; ii < count; ii += BGZ2_MEMBER_ENTRIES) {
+    size_t m = std::min(count - ii, size_t(BGZ2_MEMBER_ENTRIES));
+    uint16_t n = uint16_t(m*24);
+    gzip_header(out, 0x4);  // 0x4 = FEXTRA
+    uint8_t hdr[6] = { uint8_t(n + 4), uint8_t((n + 4) >> 8), 'S', 'I', uint8_t(n), uint8_t(n >> 8) };
+    out.write(hdr, 6, out.ctx);
+    for(size_t jj = ii; jj < ii + m; ++jj) {
+      storLE64(bytes, data[jj].offset);
+      storLE64(bytes + 8, data[jj].len_cum);
+      storLE32(bytes + 16, data[jj].crc32_cum);
+      storLE32(bytes + 20, data[jj].reserved);
+      out.write(bytes, 24, out.ctx);
+    }
+    // empty final block w/ fixed Huffman codes, then crc32 and length of empty data
+    uint8_t eob[10] = {0x03, 0x00};
+    out.write(eob, 10, out.ctx);
+    nbytes += 10 + 6 + n + 10;
+  }
+
+  ostrm.seek(12, SEEK_SET, ostrm.ctx);  // 10 bytes header + 2 bytes FEXTRA total length
+  uint8_t sub[BGZ2_HEADER_EXTRA] = { 'S', '2', 16, 0 };
+  storLE64(sub + 4, sidecar ? 0 : pos);
+  storLE32(sub + 12, uint32_t(count));
+  sub[16] = uint8_t(codec);
+  sub[17] = sidecar ? 1 : 0;
+  ostrm.write(sub, BGZ2_HEADER_EXTRA, ostrm.ctx);
+  return nbytes;
+}
+
+int bgz_version(minigz_in_t istrm)
+{
+  uint8_t x[14];
+  istrm.seek(0, SEEK_SET, istrm.ctx);
+  if(istrm.read(x, 14, istrm.ctx) != 14 || x[0] != 0x1F || x[1] != 0x8B || x[2] != 8)
+    return 0;
+  if(!(x[3] & 1 << 2) || (x[10] << 0 | x[11] << 8) < 4 || x[12] != 'S')
+    return 0;
+  return x[13] == '2' ? 2 : 1;
+}
+
+std::vector<bgz_block_info64_t> bgz_get_index64(minigz_in_t istrm, bgz_codec_t* codec, minigz_in_t* sidecar)
+{
+  std::vector<bgz_block_info64_t> res;
+  int version = bgz_version(istrm);
+  if(version == 1) {
+    for(const bgz_block_info_t& b : bgz_get_index(istrm, codec))
+      res.push_back({b.offset, b.len_cum, b.crc32_cum, b.reserved});
+    return res;
+  }
+  uint8_t x[BGZ2_HEADER_EXTRA];
+  istrm.seek(12, SEEK_SET, istrm.ctx);
+  if(version != 2 || istrm.read(x, BGZ2_HEADER_EXTRA, istrm.ctx) != BGZ2_HEADER_EXTRA || x[2] != 16 || x[3] != 0)
+    return res;
+  if(x[16] != BGZ_DEFLATE && (!codec || x[16] != BGZ_ZSTD))
+    return res;  // unsupported codec
+  if((x[17] & 1) && !sidecar)
+    return res;  // index is in sidecar
+  minigz_in_t& in = (x[17] & 1) ? *sidecar : istrm;
+  size_t count = loadLE32(x + 12);
+  in.seek(long(loadLE64(x + 4)), SEEK_SET, in.ctx);
+  res.reserve(count);
+  std::vector<uint8_t> temp;
+  while(res.size() < count) {
+    uint8_t h[16];
+    if(in.read(h, 16, in.ctx) != 16 || h[0] != 0x1F || h[1] != 0x8B || h[12] != 'S' || h[13] != 'I')
+      break;
+    size_t n = h[14] | (h[15] << 8);
+    temp.resize(n + 10);
+    if(n == 0 || n % 24 != 0 || in.read(temp.data(), n + 10, in.ctx) != n + 10)
+      break;
+    for(uint8_t* p = temp.data(); p < temp.data() + n; p += 24)
+      res.push_back({loadLE64(p), loadLE64(p + 8), loadLE32(p + 16), loadLE32(p + 20)});
+  }
+  if(res.size() != count)
+    res.clear();
+  else if(codec)
+    *codec = bgz_codec_t(x[16]);
+  return res;
+}
+
+bool bgz_read_block(minigz_in_t istrm, bgz_block_info64_t* block_info, minigz_out_t ostrm)
+{
+  size_t n = block_info[1].offset - block_info[0].offset;
+  uint32_t crc_32 = block_info[0].crc32_cum;
+  istrm.seek(long(block_info[0].offset), SEEK_SET, istrm.ctx);
+  miniz_go(-1, istrm, ostrm, &crc_32, n);
+  return crc_32 == block_info[1].crc32_cum;
+}
+
+// parallel bgz writer - each block is compressed from memory to memory by a separate miniz_go() call, so
+//  output is identical to serial case; per-block crcs are combined in order to get cumulative crc
+struct bgz_membuf_t
+{
+  std::vector<uint8_t> buf;
+  size_t pos = 0;
+
+  static size_t readfn(void* dest, size_t len, void* ctx)
+  {
+    bgz_membuf_t* m = static_cast<bgz_membuf_t*>(ctx);
+    len = std::min(len, m->buf.size() - m->pos);
+    memcpy(dest, m->buf.data() + m->pos, len);
+    m->pos += len;
+    return len;
+  }
+
+  static size_t writefn(const void* src, size_t len, void* ctx)
+  {
+    std::vector<uint8_t>& b = static_cast<bgz_membuf_t*>(ctx)->buf;
+    b.insert(b.end(), (const uint8_t*)src, (const uint8_t*)src + len);
+    return len;
+  }
+};
+
+// input stream for memory buffer w/o copying
+struct bgz_span_t
+{
+  const uint8_t* data;
+  size_t size;
+
+  static size_t readfn(void* dest, size_t len, void* ctx)
+  {
+    void* p = NULL;
+    len = readpfn(&p, len, ctx);
+    memcpy(dest, p, len);
+    return len;
+  }
+
+  static size_t readpfn(void** pdest, size_t len, void* ctx)
+  {
+    bgz_span_t* s = static_cast<bgz_span_t*>(ctx);
+    len = std::min(len, s->size);
+    *pdest = (void*)s->data;
+    s->data += len;
+    s->size -= len;
+    return len;
+  }
+};
+
+struct bgz_job_t
+{
+  bgz_membuf_t in;
+  bgz_membuf_t out;
+  uint32_t crc_32;
+  int len;
+
+  void run(int level, minigz_ctx_t* ctx)
+  {
+    crc_32 = MINIZ_GZ_CRC32_INIT;
+    if(level & MINIZ_GZ_ZSTD) {
+      len = -1;
+#ifdef MINIZ_GZ_USE_ZSTD
+      out.buf.resize(ZSTD_compressBound(in.buf.size()));
+      size_t n = ZSTD_compress(out.buf.data(), out.buf.size(), in.buf.data(), in.buf.size(),
+          level & ~(MINIZ_GZ_ZSTD | MINIZ_GZ_NO_FINISH));
+      if(!ZSTD_isError(n)) {
+        out.buf.resize(n);
+        crc_32 = miniz_crc32(crc_32, in.buf.data(), in.buf.size());
+        len = int(in.buf.size());
+      }
+#endif
+      in.buf = std::vector<uint8_t>();
+      return;
+    }
+    minigz_in_t istrm(&in, bgz_membuf_t::readfn, NULL, NULL);
+    minigz_out_t ostrm(&out, NULL, bgz_membuf_t::writefn, NULL);
+    len = miniz_go(level, istrm, ostrm, &crc_32, SIZE_MAX, ctx);
+    in.buf = std::vector<uint8_t>();  // release input
+  }
+};
+
+// write footer and v1 or v2 index
+static void bgz_finish(minigz_out_t ostrm, const std::vector<bgz_block_info64_t>& block_info, bgz_codec_t codec, bool v2)
+{
+  const bgz_block_info64_t& last = block_info.back();
+  gzip_footer(ostrm, int(uint32_t(last.len_cum)), last.crc32_cum);
+  if(v2)
+    bgz2_write_index(ostrm, last.offset + 8, block_info.data(), block_info.size(), codec);
+  else {
+    std::vector<bgz_block_info_t> v1info;
+    for(const bgz_block_info64_t& b : block_info)
+      v1info.push_back({uint32_t(b.offset), b.crc32_cum, uint32_t(b.len_cum), 0});
+    bgz_write_index(ostrm, v1info.data(), v1info.size(), codec);
+  }
+}
+
+int64_t bgz_write_parallel(minigz_in_t istrm, minigz_out_t ostrm, size_t block_size, int level, int nthreads, size_t max_blocks)
+{
+  bool v2 = level & MINIZ_GZ_BGZ_V2;
+  level &= ~MINIZ_GZ_BGZ_V2;
+  if(block_size == 0 || (!v2 && max_blocks > 4094)) return -1;
+  if(v2) max_blocks = SIZE_MAX;
+  if(nthreads <= 0) nthreads = std::max(1u, std::thread::hardware_concurrency());
+
+  // read full block (unless EOF)
+  auto readBlock = [&](bgz_membuf_t& b) {
+    size_t n = 0, nread = 0;
+    b.buf.resize(block_size);
+    while(n < block_size && (nread = istrm.read(&b.buf[n], block_size - n, istrm.ctx)) > 0)
+      n += nread;
+    b.buf.resize(n);
+    return n;
+  };
+
+  uint16_t n = v2 ? BGZ2_HEADER_EXTRA : uint16_t(4 + (max_blocks + 1)*sizeof(bgz_block_info_t));
+  bgz_header(ostrm, n);
+  std::vector<bgz_block_info64_t> block_info;
+  uint64_t pos = 12 + n, len = 0;
+  uint32_t crc_32 = MINIZ_GZ_CRC32_INIT;
+  block_info.push_back({pos, len, crc_32, 0});
+
+  minigz_ctx_t ctx;
+  // pending must be declared before pool so that pool is destroyed (and queued jobs finished) first
+  std::deque< std::pair<std::unique_ptr<bgz_job_t>, std::future<void>> > pending;
+  std::unique_ptr<ThreadPool> pool(nthreads > 1 ? new ThreadPool(nthreads) : NULL);
+  // always read one block ahead, since last block must be written w/ MZ_FINISH instead of MZ_FULL_FLUSH
+  std::unique_ptr<bgz_job_t> next(new bgz_job_t);
+  readBlock(next->in);
+  size_t nblocks = 0;
+  bool done = false;
+  while(!done || !pending.empty()) {
+    if(!done) {
+      std::unique_ptr<bgz_job_t> job(std::move(next));
+      next.reset(new bgz_job_t);
+      done = job->in.buf.size() < block_size || readBlock(next->in) == 0;
+      if(++nblocks > max_blocks) return -1;
+      int lvl = done ? level : level | MINIZ_GZ_NO_FINISH;
+      std::future<void> res;
+      if(pool) {
+        res = pool->enqueue([lvl](bgz_job_t* j) {
+          static thread_local minigz_ctx_t tctx;  // pool threads exit when we return
+          j->run(lvl, &tctx);
+        }, job.get());
+      }
+      else
+        job->run(lvl, &ctx);
+      pending.emplace_back(std::move(job), std::move(res));
+    }
+    // limit number of blocks held in memory
+    if(done || pending.size() >= size_t(2*nthreads)) {
+      bgz_job_t* job = pending.front().first.get();
+      if(pending.front().second.valid())
+        pending.front().second.wait();
+      const std::vector<uint8_t>& out = job->out.buf;
+      if(job->len < 0 || ostrm.write(out.data(), out.size(), ostrm.ctx) != out.size())
+        return -1;
+      crc_32 = miniz_crc32_combine(crc_32, job->crc_32, job->len);
+      len += job->len;
+      pos += out.size();
+      if(!v2 && (pos > UINT32_MAX || len > UINT32_MAX)) return -1;  // too large for v1 index
+      block_info.push_back({pos, len, crc_32, 0});
+      pending.pop_front();
+    }
+  }
+  bgz_finish(ostrm, block_info, level & MINIZ_GZ_ZSTD ? BGZ_ZSTD : BGZ_DEFLATE, v2);
+  return int64_t(len);
+}
+
+int64_t bgz_write_adaptive(minigz_in_t istrm, minigz_out_t ostrm, const bgz_adaptive_t& opts,
+    std::vector<bgz_block_stats_t>* stats)
+{
+  bool v2 = opts.level & MINIZ_GZ_BGZ_V2;
+  int level = opts.level & ~MINIZ_GZ_BGZ_V2;
+  size_t max_blocks = v2 ? SIZE_MAX : opts.max_blocks;
+  size_t min_block = std::max(opts.min_block, size_t(1)), max_block = std::max(opts.max_block, min_block);
+  if((level & MINIZ_GZ_ZSTD) || (!v2 && max_blocks > 4094)) return -1;
+
+  uint16_t n = v2 ? BGZ2_HEADER_EXTRA : uint16_t(4 + (max_blocks + 1)*sizeof(bgz_block_info_t));
+  bgz_header(ostrm, n);
+  std::vector<bgz_block_info64_t> block_info;
+  uint64_t pos = 12 + n, len = 0;
+  uint32_t crc_32 = MINIZ_GZ_CRC32_INIT;
+  block_info.push_back({pos, len, crc_32, 0});
+
+  minigz_ctx_t ctx, sctx;
+  std::vector<uint8_t> in, sample(gzip_bound(opts.sample_size));
+  double ratio = 0.5;  // running estimate of compression ratio
+  bool eof = false;
+  while(!eof || !in.empty()) {
+    size_t block_size = std::min(max_block, std::max(min_block, size_t(opts.target_size/ratio)));
+    // read one byte past block to detect last block, which must be written w/ MZ_FINISH
+    size_t nread = 0;
+    while(!eof && in.size() <= block_size) {
+      size_t n0 = in.size();
+      in.resize(block_size + 1);
+      nread = istrm.read(&in[n0], in.size() - n0, istrm.ctx);
+      in.resize(n0 + nread);
+      eof = nread == 0;
+    }
+    size_t blen = std::min(block_size, in.size());
+    bool last = eof && blen == in.size();
+    if(block_info.size() > max_blocks) return -1;
+
+    // estimate compressibility from samples at start, middle, and end of block
+    size_t slen = std::min(opts.sample_size/3, blen), scomp = 0, stotal = 0;
+    for(size_t spos : {size_t(0), (blen - slen)/2, blen - slen}) {
+      if(slen == 0) break;
+      int res = gzip(&in[spos], slen, sample.data(), sample.size(), 1, &sctx);
+      if(res < 0) return -1;
+      scomp += res - 18;  // gzip header and footer
+      stotal += slen;
+    }
+    double sratio = stotal ? double(scomp)/stotal : 1.0;
+    int blevel = sratio > opts.store_ratio ? 0 : level;
+
+    bgz_span_t span = {in.data(), blen};
+    bgz_membuf_t out;
+    minigz_in_t bin(&span, bgz_span_t::readfn, NULL, NULL, bgz_span_t::readpfn);
+    minigz_out_t bout(&out, NULL, bgz_membuf_t::writefn, NULL);
+    uint32_t bcrc = MINIZ_GZ_CRC32_INIT;
+    if(miniz_go(last ? blevel : blevel | MINIZ_GZ_NO_FINISH, bin, bout, &bcrc, SIZE_MAX, &ctx) != int(blen))
+      return -1;
+    if(ostrm.write(out.buf.data(), out.buf.size(), ostrm.ctx) != out.buf.size())
+      return -1;
+    crc_32 = miniz_crc32_combine(crc_32, bcrc, blen);
+    len += blen;
+    pos += out.buf.size();
+    if(!v2 && (pos > UINT32_MAX || len > UINT32_MAX)) return -1;  // too large for v1 index
+    block_info.push_back({pos, len, crc_32, 0});
+    if(stats)
+      stats->push_back({blen, out.buf.size(), float(sratio), blevel});
+    if(blen > 0)
+      ratio = std::max(0.01, 0.5*ratio + 0.5*out.buf.size()/blen);
+    in.erase(in.begin(), in.begin() + blen);
+    if(last) break;
+  }
+  bgz_finish(ostrm, block_info, BGZ_DEFLATE, v2);
+  return int64_t(len);
+}
+
+// BgzWriter
+bool BgzWriter::create(size_t _maxBlocks)
+{
+  if(_maxBlocks > 4094) return false;
+  maxBlks = _maxBlocks;
+  uint16_t n = uint16_t(4 + (maxBlks + 1)*sizeof(bgz_block_info_t));
+  strm.seek(0, SEEK_SET, strm.ctx);
+  bgz_header(strm, n);
+  index.assign(1, {uint64_t(12 + n), 0, MINIZ_GZ_CRC32_INIT, 0});
+  lastFinal = false;
+  v2 = false;
+  return true;
+}
+
+bool BgzWriter::createV2()
+{
+  maxBlks = SIZE_MAX;
+  strm.seek(0, SEEK_SET, strm.ctx);
+  bgz_header(strm, BGZ2_HEADER_EXTRA);
+  index.assign(1, {uint64_t(12 + BGZ2_HEADER_EXTRA), 0, MINIZ_GZ_CRC32_INIT, 0});
+  lastFinal = false;
+  v2 = true;
+  return true;
+}
+
+bool BgzWriter::open()
+{
+  index = bgz_get_index64(strm, NULL, sidecar);
+  v2 = bgz_version(strm) == 2;
+  uint8_t x[12];
+  strm.seek(0, SEEK_SET, strm.ctx);
+  if(index.size() < 2 || strm.read(x, 12, strm.ctx) != 12) return false;
+  maxBlks = v2 ? SIZE_MAX : ((x[10] | x[11] << 8) - 4)/sizeof(bgz_block_info_t) - 1;
+  // file written by close() has final empty block before footer, otherwise last block is final
+  uint8_t ftr[10], y[10] = {0x03, 0x00};
+  storLE32(ftr, index.back().crc32_cum);
+  storLE32(ftr + 4, index.back().len_cum);
+  memcpy(y + 2, ftr, 8);
+  strm.seek(long(index.back().offset), SEEK_SET, strm.ctx);
+  size_t n = strm.read(x, 10, strm.ctx);
+  if(n == 10 && memcmp(x, y, 10) == 0)
+    lastFinal = false;
+  else if(n >= 8 && memcmp(x, ftr, 8) == 0)
+    lastFinal = true;
+  else {
+    index.clear();
+    return false;
+  }
+  return true;
+}
+
+bool BgzWriter::truncate(size_t nblocks)
+{
+  if(nblocks > numBlocks()) return false;
+  if(nblocks < numBlocks()) {
+    index.resize(nblocks + 1);
+    lastFinal = false;
+  }
+  return true;
+}
+
+bool BgzWriter::write(const void* data, size_t len)
+{
+  if(index.empty()) return false;
+  if(lastFinal) {
+    // to append after final block, recompress it w/o MZ_FINISH
+    bgz_membuf_t last;
+    minigz_out_t ostrm(&last, NULL, bgz_membuf_t::writefn, NULL);
+    if(!bgz_read_block(strm, &index[numBlocks() - 1], ostrm)) return false;
+    index.pop_back();
+    lastFinal = false;
+    if(!write(last.buf.data(), last.buf.size())) return false;
+  }
+  if(numBlocks() >= maxBlks) return false;
+  bgz_span_t span = {(const uint8_t*)data, len};
+  bgz_membuf_t out;
+  minigz_in_t istrm(&span, bgz_span_t::readfn, NULL, NULL, bgz_span_t::readpfn);
+  minigz_out_t ostrm(&out, NULL, bgz_membuf_t::writefn, NULL);
+  uint32_t crc_32 = MINIZ_GZ_CRC32_INIT;
+  if(miniz_go(level | MINIZ_GZ_NO_FINISH, istrm, ostrm, &crc_32, SIZE_MAX, &ctx) != int(len))
+    return false;
+  const bgz_block_info64_t prev = index.back();
+  if(!v2 && (prev.offset + out.buf.size() > UINT32_MAX || prev.len_cum + len > UINT32_MAX))
+    return false;  // too large for v1 index
+  strm.seek(long(prev.offset), SEEK_SET, strm.ctx);
+  if(strm.write(out.buf.data(), out.buf.size(), strm.ctx) != out.buf.size())
+    return false;
+  index.push_back({prev.offset + out.buf.size(), prev.len_cum + len,
+      miniz_crc32_combine(prev.crc32_cum, crc_32, len), 0});
+  return true;
+}
+
+bool BgzWriter::close()
+{
+  if(index.empty()) return false;
+  uint64_t pos = index.back().offset;
+  strm.seek(long(pos), SEEK_SET, strm.ctx);
+  if(!lastFinal) {
+    uint8_t eob[2] = {0x03, 0x00};  // empty final block w/ fixed Huffman codes
+    if(strm.write(eob, 2, strm.ctx) != 2) return false;
+    pos += 2;
+  }
+  gzip_footer(strm, int(uint32_t(index.back().len_cum)), index.back().crc32_cum);
+  uint64_t end = pos + 8;
+  if(v2) {
+    size_t n = bgz2_write_index(strm, end, index.data(), index.size(), BGZ_DEFLATE, sidecar);
+    if(!sidecar)
+      end += n;
+    else if(sidecar->truncate)
+      sidecar->truncate(n, sidecar->ctx);
+  }
+  else {
+    std::vector<bgz_block_info_t> v1info;
+    for(const bgz_block_info64_t& b : index)
+      v1info.push_back({uint32_t(b.offset), b.crc32_cum, uint32_t(b.len_cum), 0});
+    bgz_write_index(strm, v1info.data(), v1info.size());
+  }
+  if(strm.truncate)
+    strm.truncate(end, strm.ctx);
+  index.clear();
+  return true;
+}
+
+// BgzReader
+// block size is known from index, so we inflate directly into final buffer w/ a single mz_inflate call; ctx
+//  inflate stream is reset instead of initializing a new one for every block
+static bool bgz_inflate_block(bgz_codec_t codec, const uint8_t* src, size_t srclen, uint8_t* dest, size_t destlen,
+    uint32_t crc0, uint32_t crc1, minigz_ctx_t* ctx)
+{
+  if(codec == BGZ_ZSTD) {
+#ifdef MINIZ_GZ_USE_ZSTD
+    size_t n = ZSTD_decompress(dest, destlen, src, srclen);
+    return !ZSTD_isError(n) && n == destlen && miniz_crc32(crc0, dest, destlen) == crc1;
+#else
+    return false;
+#endif
+  }
+  mz_stream* s = miniz_ctx_stream(ctx, -1);
+  if(!s) return false;
+  s->next_in = (uint8_t*)src;
+  s->avail_in = srclen;
+  s->next_out = dest;
+  s->avail_out = destlen;
+  int res = mz_inflate(s, MZ_SYNC_FLUSH);
+  bool ok = (res == MZ_OK || res == MZ_STREAM_END || (res == MZ_BUF_ERROR && destlen == 0)) && s->avail_out == 0;
+  return ok && miniz_crc32(crc0, dest, destlen) == crc1;
+}
+
+struct BgzReader::Block
+{
+  std::vector<uint8_t> comp;
+  std::vector<uint8_t> data;
+  std::future<bool> pending;
+  uint64_t lastUse = 0;
+  bool ok = false;
+};
+
+BgzReader::BgzReader(const minigz_in_t& _istrm, size_t _maxCached, int nthreads, minigz_in_t* sidecar)
+  : istrm(_istrm), index(bgz_get_index64(_istrm, &codec, sidecar)), maxCached(std::max(size_t(1), _maxCached))
+{
+  if(nthreads <= 0) nthreads = std::max(1u, std::thread::hardware_concurrency());
+  cache.resize(numBlocks());
+  readAhead = nthreads > 1 ? std::min(size_t(nthreads), maxCached - 1) : 0;
+  if(nthreads > 1)
+    pool.reset(new ThreadPool(nthreads));
+}
+
+BgzReader::~BgzReader()
+{
+  pool.reset();  // finish background work before freeing blocks
+}
+
+size_t BgzReader::findBlock(uint64_t offset) const
+{
+  // first block whose end (index[ii+1].len_cum) is past offset
+  auto it = std::upper_bound(index.begin() + 1, index.end(), offset,
+      [](uint64_t off, const bgz_block_info64_t& b) { return off < b.len_cum; });
+  return it - index.begin() - 1;
+}
+
+// start loading block (if not already cached), evicting least recently used block if necessary
+BgzReader::Block* BgzReader::fetchBlock(size_t idx)
+{
+  Block* block = cache[idx].get();
+  if(!block) {
+    if(nCached >= maxCached) {
+      size_t lru = SIZE_MAX;
+      for(size_t ii = 0; ii < cache.size(); ++ii) {
+        if(cache[ii] && (lru == SIZE_MAX || cache[ii]->lastUse < cache[lru]->lastUse))
+          lru = ii;
+      }
+      if(cache[lru]->pending.valid())
+        cache[lru]->pending.wait();
+      cache[lru].reset();
+      --nCached;
+    }
+    cache[idx].reset(new Block);
+    block = cache[idx].get();
+    ++nCached;
+
+    const bgz_block_info64_t* b = &index[idx];
+    block->comp.resize(b[1].offset - b[0].offset);
+    block->data.resize(b[1].len_cum - b[0].len_cum);
+    istrm.seek(long(b[0].offset), SEEK_SET, istrm.ctx);
+    if(istrm.read(block->comp.data(), block->comp.size(), istrm.ctx) != block->comp.size())
+      block->ok = false;
+    else if(pool) {
+      block->pending = pool->enqueue([this, block, b]() {
+        static thread_local minigz_ctx_t tctx;  // one inflate stream per pool thread
+        bool ok = bgz_inflate_block(codec, block->comp.data(), block->comp.size(),
+            block->data.data(), block->data.size(), b[0].crc32_cum, b[1].crc32_cum, &tctx);
+        block->comp = std::vector<uint8_t>();
+        return ok;
+      });
+    }
+    else {
+      block->ok = bgz_inflate_block(codec, block->comp.data(), block->comp.size(),
+          block->data.data(), block->data.size(), b[0].crc32_cum, b[1].crc32_cum, &ctx);
+      block->comp = std::vector<uint8_t>();
+    }
+  }
+  block->lastUse = ++useCount;
+  return block;
+}
+
+// load block and wait for inflation to complete; returns NULL on error
+const BgzReader::Block* BgzReader::getBlock(size_t idx)
+{
+  Block* block = fetchBlock(idx);
+  // only read ahead for sequential access
+  if(idx == lastBlock + 1) {
+    for(size_t ii = idx + 1; ii <= idx + readAhead && ii < cache.size(); ++ii)
+      fetchBlock(ii);
+    block->lastUse = ++useCount;  // make sure read ahead blocks are evicted before this one
+  }
+  lastBlock = idx;
+  if(block->pending.valid())
+    block->ok = block->pending.get();
+  if(!block->ok) {
+    // don't keep failed block in cache so next read retries
+    cache[idx].reset();
+    --nCached;
+    return NULL;
+  }
+  return block;
+}
+
+int64_t BgzReader::read(uint64_t offset, size_t len, void* dest)
+{
+  if(offset >= size()) return 0;
+  len = size_t(std::min(uint64_t(len), size() - offset));
+  uint8_t* out = (uint8_t*)dest;
+  for(size_t idx = findBlock(offset); len > 0; ++idx) {
+    const Block* block = getBlock(idx);
+    if(!block) return -1;
+    size_t start = size_t(offset - index[idx].len_cum);
+    size_t n = std::min(len, block->data.size() - start);
+    memcpy(out, block->data.data() + start, n);
+    out += n;
+    offset += n;
+    len -= n;
+  }
+  return int64_t(out - (uint8_t*)dest);
+}
+
+void BgzReader::prefetch(uint64_t offset, size_t len)
+{
+  if(offset >= size() || len == 0) return;
+  size_t end = findBlock(std::min(offset + len, size()) - 1);
+  for(size_t idx = findBlock(offset), n = 0; idx <= end && n < maxCached; ++idx, ++n)
+    fetchBlock(idx);
+}
+
+// GzipStream
+GzipStream::GzipStream(const minigz_out_t& _sink, int _level, size_t bufSize, minigz_ctx_t* _ctx)
+  : sink(_sink), level(_level < 0 ? -1 : _level), ctx(_ctx), buf(std::max(bufSize, size_t(64)))
+{
+  mz_stream* s = ctx ? miniz_ctx_stream(ctx, level) : new mz_stream;
+  if(!s || (!ctx && miniz_init(s, level))) {
+    if(!ctx) delete s;
+    state = GZ_ERROR;
+    return;
+  }
+  s->next_in = NULL;
+  s->avail_in = 0;
+  strm = s;
+  if(level >= 0) {
+    uint8_t hdr[10] = { 0x1F, 0x8B, 8, 0, 0,0,0,0, 0, 0xFF };  // see gzip_header()
+    memcpy(buf.data(), hdr, 10);
+    nbuf = nOut = 10;
+    state = GZ_DATA;
+  }
+}
+
+GzipStream::~GzipStream()
+{
+  mz_stream* s = (mz_stream*)strm;
+  if(s && !ctx) {
+    level < 0 ? inflateEnd(s) : deflateEnd(s);
+    delete s;
+  }
+}
+
+bool GzipStream::writeBuf()
+{
+  if(nbuf > 0 && sink.write(buf.data(), nbuf, sink.ctx) != nbuf) {
+    state = GZ_ERROR;
+    return false;
+  }
+  nbuf = 0;
+  return true;
+}
+
+// deflate or inflate data into buf, writing buf to sink when full
+bool GzipStream::run(const uint8_t* data, size_t len, int flush)
+{
+  mz_stream& s = *(mz_stream*)strm;
+  s.next_in = (uint8_t*)data;
+  s.avail_in = len;
+  for(;;) {
+    s.next_out = buf.data() + nbuf;
+    s.avail_out = buf.size() - nbuf;
+    const uint8_t* next_in = s.next_in;
+    int res = level < 0 ? mz_inflate(&s, MZ_SYNC_FLUSH) : mz_deflate(&s, flush);
+    size_t nout = buf.size() - s.avail_out - nbuf;
+    if(level < 0)
+      crc_32 = miniz_crc32(crc_32, buf.data() + nbuf, nout);
+    else
+      crc_32 = miniz_crc32(crc_32, next_in, s.next_in - next_in);
+    nbuf += nout;
+    nOut += nout;
+    if(res != MZ_OK && res != MZ_STREAM_END && res != MZ_BUF_ERROR) {
+      state = GZ_ERROR;
+      return false;
+    }
+    if(res == MZ_STREAM_END) {
+      if(level < 0) state = GZ_FOOTER;
+      return true;
+    }
+    if(nbuf == buf.size()) {
+      if(!writeBuf()) return false;
+    }
+    else if(s.avail_in == 0 && flush != MZ_FINISH)  // all input consumed and all output for flush produced
+      return true;
+  }
+}
+
+bool GzipStream::feed(const void* data, size_t len)
+{
+  if(state == GZ_ERROR) return false;
+  if(level >= 0) {
+    if(state != GZ_DATA) return false;
+    nIn += len;
+    return run((const uint8_t*)data, len, MZ_NO_FLUSH);
+  }
+
+  const uint8_t* p = (const uint8_t*)data;
+  nIn += len;
+  // accumulate header, copying at most 4KB at a time
+  while(state == GZ_HEADER && len > 0) {
+    size_t n0 = partial.size(), m = std::min(len, size_t(4096));
+    partial.insert(partial.end(), p, p + m);
+    size_t hdrlen = gzip_header_size(partial.data(), partial.size(), 0);
+    if(hdrlen) {
+      m = hdrlen - n0;
+      partial.clear();
+      state = GZ_DATA;
+    }
+    else if(partial[0] != 0x1F || (partial.size() > 1 && partial[1] != 0x8B) || (partial.size() > 2 && partial[2] != 8)) {
+      state = GZ_ERROR;
+      return false;
+    }
+    p += m;
+    len -= m;
+  }
+  if(state == GZ_DATA && len > 0) {
+    if(!run(p, len, MZ_SYNC_FLUSH)) return false;
+    mz_stream* s = (mz_stream*)strm;
+    p = s->next_in;
+    len = s->avail_in;
+  }
+  if(state == GZ_FOOTER && len > 0) {
+    size_t m = std::min(len, 8 - partial.size());
+    partial.insert(partial.end(), p, p + m);
+    if(partial.size() == 8) {
+      if(loadLE32(&partial[0]) != crc_32 || loadLE32(&partial[4]) != uint32_t(nOut)) {
+        state = GZ_ERROR;
+        return false;
+      }
+      state = GZ_DONE;
+    }
+  }
+  return true;
+}
+
+bool GzipStream::flush()
+{
+  if(state == GZ_ERROR) return false;
+  if(level >= 0 && state == GZ_DATA && !run(NULL, 0, MZ_FULL_FLUSH))
+    return false;
+  return writeBuf();
+}
+
+bool GzipStream::finish()
+{
+  if(state == GZ_ERROR) return false;
+  if(level < 0)
+    return writeBuf() && state == GZ_DONE;
+  if(state == GZ_DONE) return true;
+  if(!run(NULL, 0, MZ_FINISH)) return false;
+  if(buf.size() - nbuf < 8 && !writeBuf()) return false;
+  storLE32(&buf[nbuf], crc_32);
+  storLE32(&buf[nbuf + 4], uint32_t(nIn));
+  nbuf += 8;
+  nOut += 8;
+  state = GZ_DONE;
+  return writeBuf();
+}
+
 #endif // MINIZ_GZ_IMPLEMENTATION
 
 // g++ -DMINIZ_GZ_UTIL -DMINIZ_GZ_IMPLEMENTATION -isystem .. -o bgunzip -x c++ miniz_gzip.h
@@ -343,7 +1696,7 @@ int main(int argc, char* argv[])
   else outname.append(".infl");
 
   std::fstream fin(argv[1], std::fstream::in | std::fstream::binary);
-  std::vector<bgz_block_info_t> block_info = bgz_get_index(fin);
+  std::vector<bgz_block_info64_t> block_info = bgz_get_index64(fin);
   if(block_info.empty()) {
     std::fstream fout(outname.c_str(), std::fstream::out | std::fstream::binary);
     fin.seekg(0);
@@ -361,11 +1714,12 @@ int main(int argc, char* argv[])
   }
   else {
     for(size_t ii = 0; ii < block_info.size() - 1; ++ii) {
-      bgz_block_info_t* b = &block_info[ii];
+      bgz_block_info64_t* b = &block_info[ii];
       std::string namehack = outname + std::to_string(0.001 * ii + 1e-6).substr(1, 4);
       std::fstream fout(namehack.c_str(), std::fstream::out | std::fstream::binary);
       bool ok = bgz_read_block(fin, b, fout);
-      printf("block %03d: offset %d, cum_len: %d  %s\n", ii, b->offset, b->len_cum, ok ? "OK" : "ERROR");
+      printf("block %03d: offset %llu, cum_len: %llu  %s\n", int(ii), (unsigned long long)b->offset,
+          (unsigned long long)b->len_cum, ok ? "OK" : "ERROR");
     }
   }
   return 0;
@@ -374,11 +1728,17 @@ int main(int argc, char* argv[])
 #endif //MINIZ_GZ_UTIL
 
 // To build test executable (replace .. with path to directory containing miniz/ as needed)
-//   g++ -march=native -O3 -DMINIZ_GZ_TEST -DMINIZ_GZ_IMPLEMENTATION -isystem .. -o gztest -x c++ miniz_gzip.h ../miniz/miniz.c ../miniz/miniz_tdef.c ../miniz/miniz_tinfl.c
+//   g++ -march=native -O3 -DMINIZ_GZ_TEST -DMINIZ_GZ_IMPLEMENTATION -isystem .. -I../stb -o gztest -x c++ miniz_gzip.h ../miniz/miniz.c ../miniz/miniz_tdef.c ../miniz/miniz_tinfl.c -lpthread
+// gztest runs tests; gztest --bench [files...] runs benchmark over synthetic data and files (JSON lines output)
 #ifdef MINIZ_GZ_TEST
 #include <sstream>
 #include <fstream>
 
+#define PLATFORMUTIL_IMPLEMENTATION
+#define STRINGUTIL_IMPLEMENTATION
+#define FILEUTIL_IMPLEMENTATION
+#include "fileutil.h"
+
 #ifndef ASSERT
 #include <assert.h>
 #define ASSERT assert
@@ -558,6 +1918,552 @@ void test_level0_block(int test_len)
   chunkSize = 1 << 20;
 }
 
+// DOC: this shows how to gzip to base64 text and gunzip from base64 text in a single pass
+void test_base64_gzip(int test_len)
+{
+  std::string test_str = make_test_str(test_len);
+  MemStream b64strm;
+  {
+    ConstMemStream src_strm(test_str.data(), test_str.size());
+    Base64EncodeStream enc_strm(b64strm);
+    ASSERT(gzip(minigz_io_t(src_strm), minigz_io_t(enc_strm)) == test_len);
+  }  // ~Base64EncodeStream() writes final group
+  // check against gzip to memory then base64_encode
+  {
+    ConstMemStream src_strm(test_str.data(), test_str.size());
+    MemStream def_strm;
+    gzip(minigz_io_t(src_strm), minigz_io_t(def_strm));
+    ASSERT(base64_encode((const unsigned char*)def_strm.data(), def_strm.size())
+        == std::string(b64strm.data(), b64strm.size()));
+  }
+
+  // add line breaks, which should be skipped by decoder
+  std::string b64text;
+  for(size_t pos = 0; pos < b64strm.size(); pos += 76)
+    b64text.append(b64strm.data() + pos, std::min(size_t(76), b64strm.size() - pos)).append("\r\n");
+
+  for(size_t chunk : {size_t(1000), size_t(test_len/3), size_t(1 << 20)}) {
+    chunkSize = chunk;
+    ConstMemStream text_strm(b64text.data(), b64text.size());
+    Base64DecodeStream dec_strm(text_strm);
+    MemStream inf_strm;
+    ASSERT(gunzip(minigz_io_t(dec_strm), minigz_io_t(inf_strm)) == test_len);
+    ASSERT(std::string(inf_strm.data(), inf_strm.size()) == test_str);
+  }
+  chunkSize = 1 << 20;
+}
+
+// DOC: this shows how to reuse compression state for many small inputs
+void test_gzip_ctx()
+{
+  minigz_ctx_t ctx;
+  for(int ii = 0; ii < 200; ++ii) {
+    std::string test_str = make_test_str(1 + rand() % 5000);
+    int level = ii % 10;
+    if(ii == 100) chunkSize = 1000;  // buffers should be reallocated
+    std::stringstream src_strm(test_str), ref_src_strm(test_str);
+    std::stringstream def_strm, ref_strm, inf_strm;
+    ASSERT(gzip(src_strm, def_strm, level, &ctx) == int(test_str.size()));
+    gzip(ref_src_strm, ref_strm, level);
+    ASSERT(def_strm.str() == ref_strm.str());  // reset stream gives same output as new stream
+    def_strm.seekg(0);
+    ASSERT(gunzip(def_strm, inf_strm, &ctx) == int(test_str.size()));
+    ASSERT(inf_strm.str() == test_str);
+    if(ii % 50 == 0) {
+      // context should recover from error
+      std::string bad = def_strm.str();
+      bad[12] ^= 0xFF;
+      std::stringstream bad_strm(bad), bad_inf;
+      ASSERT(gunzip(bad_strm, bad_inf, &ctx) < 0);
+    }
+  }
+  chunkSize = 1 << 20;
+}
+
+// DOC: this shows how to gzip and gunzip between memory buffers
+void test_gzip_mem(int test_len)
+{
+  std::string test_str = make_test_str(test_len);
+  minigz_ctx_t ctx;
+  for(minigz_ctx_t* pctx : {(minigz_ctx_t*)NULL, &ctx}) {
+    std::vector<uint8_t> comp(gzip_bound(test_len));
+    int n = gzip(test_str.data(), test_len, comp.data(), comp.size(), 6, pctx);
+    ASSERT(n > 0);
+    comp.resize(n);
+#ifndef MINIZ_GZ_USE_LIBDEFLATE
+    // compare to stream version
+    std::stringstream src_strm(test_str), def_strm;
+    gzip(src_strm, def_strm);
+    ASSERT(def_strm.str() == std::string((char*)comp.data(), n));
+#endif
+
+    ASSERT(gunzip_size(comp.data(), n) == size_t(test_len));
+    std::vector<char> out(test_len);
+    ASSERT(gunzip(comp.data(), n, out.data(), out.size(), pctx) == test_len);
+    ASSERT(std::string(out.data(), test_len) == test_str);
+    ASSERT(gunzip(comp.data(), n, out.data(), test_len - 1, pctx) < 0);  // dest too small
+    ASSERT(gzip(test_str.data(), test_len, out.data(), 100, 6, pctx) < 0);
+    comp[n - 6] ^= 0x1;  // corrupt CRC
+    ASSERT(gunzip(comp.data(), n, out.data(), out.size(), pctx) < 0);
+  }
+
+  // bgz file (FEXTRA header); stream gunzip from ConstMemStream uses readp
+  std::stringstream src_strm(test_str), def_strm;
+  bgz_write_parallel(src_strm, def_strm, test_len/3, 6, 1);
+  std::string bgz = def_strm.str();
+  std::vector<char> out(gunzip_size(bgz.data(), bgz.size()));
+  ASSERT(gunzip(bgz.data(), bgz.size(), out.data(), out.size()) == test_len);
+  ASSERT(std::string(out.data(), test_len) == test_str);
+  for(size_t chunk : {size_t(1000), size_t(1 << 20)}) {
+    chunkSize = chunk;
+    ConstMemStream gz_strm(bgz.data(), bgz.size());
+    MemStream inf_strm;
+    ASSERT(gunzip(minigz_io_t(gz_strm), minigz_io_t(inf_strm)) == test_len);
+    ASSERT(std::string(inf_strm.data(), inf_strm.size()) == test_str);
+  }
+  chunkSize = 1 << 20;
+}
+
+// optional codecs
+void test_codecs(int test_len)
+{
+  std::string test_str = make_test_str(test_len);
+#ifdef MINIZ_GZ_USE_LIBDEFLATE
+  // libdeflate output must be readable by miniz and vice versa
+  minigz_ctx_t ctx;
+  for(int level : {1, 6, 9}) {
+    std::vector<uint8_t> comp(gzip_bound(test_len));
+    int n = gzip(test_str.data(), test_len, comp.data(), comp.size(), level, &ctx);
+    ASSERT(n > 0);
+    std::vector<char> out(test_len);
+    ASSERT(gunzip_mem_miniz(comp.data(), n, out.data(), out.size(), NULL) == test_len);
+    ASSERT(std::string(out.data(), test_len) == test_str);
+    std::stringstream def_strm(std::string((char*)comp.data(), n)), inf_strm;
+    ASSERT(gunzip(def_strm, inf_strm) == test_len && inf_strm.str() == test_str);
+    n = gzip_mem_miniz(test_str.data(), test_len, comp.data(), comp.size(), level, NULL);
+    ASSERT(gunzip(comp.data(), n, out.data(), out.size(), &ctx) == test_len);
+    ASSERT(std::string(out.data(), test_len) == test_str);
+    ASSERT(gunzip(comp.data(), n, out.data(), test_len - 1, &ctx) < 0);
+  }
+#endif
+#ifdef MINIZ_GZ_USE_ZSTD
+  std::stringstream src_strm(test_str), def_strm;
+  ASSERT(bgz_write_parallel(src_strm, def_strm, test_len/5, 3 | MINIZ_GZ_ZSTD, 2) == test_len);
+  ASSERT(bgz_get_index(def_strm).empty());  // not readable as deflate bgz
+  bgz_codec_t codec = BGZ_DEFLATE;
+  ASSERT(bgz_get_index(def_strm, &codec).size() == 6 && codec == BGZ_ZSTD);
+  BgzReader reader(def_strm, 2, 2);
+  ASSERT(reader.isValid() && reader.blockCodec() == BGZ_ZSTD);
+  std::vector<char> out(test_len);
+  ASSERT(reader.read(0, test_len, out.data()) == test_len);
+  ASSERT(std::string(out.data(), test_len) == test_str);
+  ASSERT(reader.read(test_len/2, 1000, out.data()) == 1000);
+  ASSERT(memcmp(out.data(), &test_str[test_len/2], 1000) == 0);
+#endif
+}
+
+void test_crc32()
+{
+  std::vector<uint8_t> buf(100000);
+  for(uint8_t& b : buf) b = rand();
+  // all lengths and alignments around SIMD thresholds, plus incremental updates
+  for(size_t off = 0; off < 16; ++off) {
+    for(size_t len = 0; len < 300; ++len) {
+      uint32_t ref = mz_crc32(MZ_CRC32_INIT, &buf[off], len);
+      ASSERT(miniz_crc32(MZ_CRC32_INIT, &buf[off], len) == ref);
+      ASSERT(crc32_slice8(MZ_CRC32_INIT, &buf[off], len) == ref);
+      uint32_t crc = miniz_crc32(MZ_CRC32_INIT, &buf[off], len/3);
+      ASSERT(miniz_crc32(crc, &buf[off + len/3], len - len/3) == ref);
+    }
+  }
+  uint32_t ref = mz_crc32(MZ_CRC32_INIT, buf.data(), buf.size());
+  ASSERT(miniz_crc32(MZ_CRC32_INIT, buf.data(), buf.size()) == ref);
+  ASSERT(miniz_crc32(0x12345678, buf.data(), 1000) == mz_crc32(0x12345678, buf.data(), 1000));
+  for(size_t split : {size_t(0), size_t(1), size_t(777), size_t(65536), buf.size()}) {
+    uint32_t crc_a = miniz_crc32(MZ_CRC32_INIT, buf.data(), split);
+    uint32_t crc_b = miniz_crc32(MZ_CRC32_INIT, buf.data() + split, buf.size() - split);
+    ASSERT(miniz_crc32_combine(crc_a, crc_b, buf.size() - split) == ref);
+  }
+}
+
+// DOC: this shows how to replace the tail of a block gzip file in place
+void test_bgz_writer(int test_len)
+{
+  std::vector<std::string> src;
+  for(int ii = 0; ii < 8; ++ii)
+    src.push_back(make_test_str(test_len/4 + rand() % test_len));
+  auto check = [](MemStream& strm, const std::string& expect, size_t nblocks) {
+    std::string data(strm.data(), strm.size());
+    std::stringstream gz_strm(data), inf_strm;
+    ASSERT(gunzip(gz_strm, inf_strm) == int(expect.size()) && inf_strm.str() == expect);
+    ConstMemStream rd_strm(strm.data(), strm.size());
+    BgzReader reader(minigz_io_t(rd_strm), 4);
+    ASSERT(reader.numBlocks() == nblocks && reader.size() == expect.size());
+    std::vector<char> buf(expect.size());
+    ASSERT(reader.read(0, expect.size(), buf.data()) == int(expect.size()));
+    ASSERT(memcmp(buf.data(), expect.data(), expect.size()) == 0);
+  };
+
+  MemStream strm;
+  {
+    BgzWriter writer(minigz_io_t(strm), 6);
+    ASSERT(writer.create(6));
+    for(int ii = 0; ii < 5; ++ii)
+      ASSERT(writer.write(src[ii].data(), src[ii].size()));
+    ASSERT(writer.close());
+  }
+  check(strm, src[0] + src[1] + src[2] + src[3] + src[4], 5);
+
+  // replace blocks 3 and 4 w/ a single shorter block
+  {
+    BgzWriter writer(minigz_io_t(strm), 6);
+    ASSERT(writer.open() && writer.numBlocks() == 5 && writer.maxBlocks() == 6);
+    ASSERT(writer.truncate(3) && writer.numBlocks() == 3);
+    ASSERT(writer.size() == src[0].size() + src[1].size() + src[2].size());
+    ASSERT(writer.write(src[5].data(), 100));
+    ASSERT(writer.close());
+  }
+  size_t shortsize = strm.size();
+  check(strm, src[0] + src[1] + src[2] + src[5].substr(0, 100), 4);
+
+  // append, exceeding index capacity
+  {
+    BgzWriter writer(minigz_io_t(strm), 1);
+    ASSERT(writer.open());
+    ASSERT(writer.write(src[6].data(), src[6].size()));
+    ASSERT(writer.write(src[7].data(), src[7].size()));
+    ASSERT(!writer.write(src[7].data(), src[7].size()));
+    ASSERT(writer.close());
+  }
+  ASSERT(strm.size() > shortsize);
+  check(strm, src[0] + src[1] + src[2] + src[5].substr(0, 100) + src[6] + src[7], 6);
+
+  // append to file from bgz_write_parallel, where last block is final
+  std::string all = src[0] + src[1] + src[2];
+  std::stringstream src_strm(all), def_strm;
+  size_t nblocks = (all.size() + src[0].size() - 1)/src[0].size();
+  bgz_write_parallel(src_strm, def_strm, src[0].size(), 6, 1, 40);
+  std::string bgz = def_strm.str();
+  MemStream strm2(bgz.data(), bgz.size());
+  {
+    BgzWriter writer{minigz_io_t(strm2)};
+    ASSERT(writer.open() && writer.numBlocks() == nblocks);
+    ASSERT(writer.write(src[3].data(), src[3].size()));
+    ASSERT(writer.close());
+  }
+  check(strm2, all + src[3], nblocks + 1);
+  // unchanged file remains valid
+  MemStream strm3(bgz.data(), bgz.size());
+  {
+    BgzWriter writer{minigz_io_t(strm3)};
+    ASSERT(writer.open() && writer.truncate(nblocks) && writer.close());
+  }
+  ASSERT(std::string(strm3.data(), strm3.size()) == bgz);
+
+  MemStream not_bgz("not a gzip file", 15);
+  ASSERT(!BgzWriter(minigz_io_t(not_bgz)).open());
+}
+
+// DOC: this shows how to write block gzip file w/ blocks compressed in parallel
+void test_bgz_parallel(int test_len)
+{
+  std::string test_str = make_test_str(test_len);
+  for(size_t block_size : {size_t(test_len/7), size_t(test_len/4), size_t(test_len), size_t(2*test_len)}) {
+    // build reference w/ serial miniz_go() calls
+    std::stringstream ref_strm;
+    {
+      size_t nblocks = (test_len + block_size - 1)/block_size;
+      std::vector<bgz_block_info_t> block_info;
+      bgz_header(ref_strm, 4 + 1023*sizeof(bgz_block_info_t));
+      uint32_t crc_32 = MZ_CRC32_INIT;
+      uint32_t len = 0;
+      block_info.push_back({uint32_t(ref_strm.tellp()), crc_32, len, 0});
+      for(size_t ii = 0; ii < nblocks; ++ii) {
+        std::stringstream src(test_str.substr(ii*block_size, block_size));
+        len += miniz_go(ii + 1 < nblocks ? 6 | MINIZ_GZ_NO_FINISH : 6, src, ref_strm, &crc_32);
+        block_info.push_back({uint32_t(ref_strm.tellp()), crc_32, len, 0});
+      }
+      gzip_footer(ref_strm, len, crc_32);
+      bgz_write_index(ref_strm, block_info.data(), block_info.size());
+    }
+
+    for(int nthreads : {1, 2, 5}) {
+      std::stringstream src_strm(test_str);
+      std::stringstream def_strm;
+      ASSERT(bgz_write_parallel(src_strm, def_strm, block_size, 6, nthreads) == test_len);
+      ASSERT(def_strm.str() == ref_strm.str());
+
+      std::vector<bgz_block_info_t> block_info = bgz_get_index(def_strm);
+      ASSERT(block_info.size() == (test_len + block_size - 1)/block_size + 1);
+      for(size_t ii = 0; ii < block_info.size() - 1; ++ii) {
+        std::stringstream inf_block;
+        ASSERT(bgz_read_block(def_strm, &block_info[ii], inf_block));
+        ASSERT(inf_block.str() == test_str.substr(ii*block_size, block_size));
+      }
+    }
+  }
+
+  // empty input and too many blocks
+  std::stringstream empty_strm, def_strm, inf_strm;
+  ASSERT(bgz_write_parallel(empty_strm, def_strm, 1024, 6, 2) == 0);
+  def_strm.seekg(0);
+  ASSERT(gunzip(def_strm, inf_strm) == 0 && inf_strm.str().empty());
+  std::stringstream src_strm(test_str), def2_strm;
+  ASSERT(bgz_write_parallel(src_strm, def2_strm, test_len/8, 6, 2, 4) < 0);
+
+  uint32_t crc_a = mz_crc32(MZ_CRC32_INIT, (const uint8_t*)test_str.data(), 1000);
+  uint32_t crc_b = mz_crc32(MZ_CRC32_INIT, (const uint8_t*)test_str.data() + 1000, test_len - 1000);
+  uint32_t crc_ab = mz_crc32(MZ_CRC32_INIT, (const uint8_t*)test_str.data(), test_len);
+  ASSERT(miniz_crc32_combine(crc_a, crc_b, test_len - 1000) == crc_ab);
+  ASSERT(miniz_crc32_combine(crc_a, MZ_CRC32_INIT, 0) == crc_a);
+}
+
+// DOC: this shows how to read arbitrary ranges from block gzip file
+void test_bgz_reader(int test_len)
+{
+  std::string test_str = make_test_str(test_len);
+  std::stringstream src_strm(test_str);
+  std::stringstream def_strm;
+  size_t block_size = test_len/9;
+  ASSERT(bgz_write_parallel(src_strm, def_strm, block_size, 6, 1) == test_len);
+
+  for(int nthreads : {1, 4}) {
+    for(size_t ncache : {size_t(1), size_t(3), size_t(16)}) {
+      BgzReader reader(def_strm, ncache, nthreads);
+      ASSERT(reader.isValid() && reader.size() == size_t(test_len) && reader.numBlocks() == 10);
+      std::vector<char> buf(test_len);
+      // whole file, sequential reads crossing block boundaries, then random reads
+      ASSERT(reader.read(0, test_len + 100, buf.data()) == test_len);
+      ASSERT(std::string(buf.data(), test_len) == test_str);
+      for(size_t pos = 0; pos < size_t(test_len); pos += 3001) {
+        int64_t n = reader.read(pos, 3001, buf.data());
+        ASSERT(n == int(std::min(size_t(3001), test_len - pos)));
+        ASSERT(memcmp(buf.data(), &test_str[pos], n) == 0);
+      }
+      for(int ii = 0; ii < 200; ++ii) {
+        size_t pos = rand() % test_len, len = rand() % (2*block_size);
+        int64_t n = reader.read(pos, len, buf.data());
+        ASSERT(n == int(std::min(len, test_len - pos)));
+        ASSERT(memcmp(buf.data(), &test_str[pos], n) == 0);
+      }
+      reader.prefetch(test_len/2, test_len);
+      ASSERT(reader.read(test_len - 10, 10, buf.data()) == 10);
+      ASSERT(reader.read(test_len, 10, buf.data()) == 0);
+    }
+  }
+
+  // corrupt a byte in block 3
+  std::string bad = def_strm.str();
+  std::vector<bgz_block_info_t> block_info = bgz_get_index(def_strm);
+  bad[block_info[3].offset + 20] ^= 0x55;
+  std::stringstream bad_strm(bad);
+  BgzReader reader(bad_strm, 4, 1);
+  std::vector<char> buf(block_size);
+  ASSERT(reader.read(0, block_size, buf.data()) == int(block_size));
+  ASSERT(reader.read(block_info[3].len_cum, 10, buf.data()) < 0);
+  // failed block is not cached, so read succeeds once data is fixed
+  bad_strm.str(def_strm.str());
+  bad_strm.clear();
+  ASSERT(reader.read(block_info[3].len_cum, 10, buf.data()) == 10);
+
+  std::stringstream not_bgz("not a gzip file");
+  ASSERT(!BgzReader(not_bgz).isValid());
+}
+
+// DOC: adaptive block gzip for mixed content - incompressible blocks are stored
+void test_bgz_adaptive(int test_len)
+{
+  // compressible text, then random bytes, then text again
+  std::string noise(test_len, '\0');
+  for(char& c : noise) c = char(rand());
+  std::string test_str = make_test_str(test_len) + noise + make_test_str(test_len);
+  for(int flags : {0, MINIZ_GZ_BGZ_V2}) {
+    bgz_adaptive_t opts;
+    opts.level = 6 | flags;
+    opts.target_size = 4096;
+    opts.min_block = 1024;
+    opts.max_block = 64*1024;
+    std::vector<bgz_block_stats_t> stats;
+    std::stringstream src_strm(test_str), def_strm, inf_strm;
+    ASSERT(bgz_write_adaptive(src_strm, def_strm, opts, &stats) == int64_t(test_str.size()));
+    def_strm.seekg(0);
+    ASSERT(gunzip(def_strm, inf_strm) == int(test_str.size()) && inf_strm.str() == test_str);
+    BgzReader reader(def_strm);
+    ASSERT(reader.numBlocks() == stats.size());
+    std::vector<char> buf(test_str.size());
+    ASSERT(reader.read(0, buf.size(), buf.data()) == int(buf.size()) && memcmp(buf.data(), test_str.data(), buf.size()) == 0);
+
+    uint64_t pos = 0;
+    size_t nstored = 0;
+    for(size_t ii = 0; ii < stats.size(); ++ii) {
+      const bgz_block_stats_t& st = stats[ii];
+      ASSERT(st.len == reader.blockIndex()[ii+1].len_cum - reader.blockIndex()[ii].len_cum);
+      ASSERT(st.comp_len == reader.blockIndex()[ii+1].offset - reader.blockIndex()[ii].offset);
+      ASSERT(st.len <= opts.max_block && (st.len >= opts.min_block || ii + 1 == stats.size()));
+      // blocks entirely within random data are stored (and then have ratio slightly > 1)
+      if(pos >= size_t(test_len) && pos + st.len <= size_t(2*test_len)) {
+        ASSERT(st.level == 0 && st.ratio() > 1);
+        ++nstored;
+      }
+      if(pos + st.len <= size_t(test_len))
+        ASSERT(st.level == 6 && st.ratio() < opts.store_ratio);
+      // after first few blocks, compressed size of compressible blocks tracks target
+      if(ii > 4 && pos > size_t(2*test_len) && ii + 1 < stats.size() && st.len < opts.max_block)
+        ASSERT(st.comp_len > opts.target_size/4 && st.comp_len < 4*opts.target_size);
+      pos += st.len;
+    }
+    ASSERT(pos == test_str.size() && nstored > 0);
+  }
+  // empty input
+  std::stringstream empty_strm, def_strm, inf_strm;
+  ASSERT(bgz_write_adaptive(empty_strm, def_strm, bgz_adaptive_t()) == 0);
+  def_strm.seekg(0);
+  ASSERT(gunzip(def_strm, inf_strm) == 0);
+}
+
+// DOC: this shows how to compress and decompress data as it becomes available
+static size_t test_sink_write(const void* src, size_t len, void* ctx)
+{
+  std::string* s = static_cast<std::string*>(ctx);
+  s->append((const char*)src, len);
+  return len;
+}
+
+void test_gzip_stream(int test_len)
+{
+  std::string test_str = make_test_str(test_len);
+  minigz_ctx_t ctx;
+  for(minigz_ctx_t* pctx : {(minigz_ctx_t*)NULL, &ctx}) {
+    std::string gz;
+    GzipStream zs(minigz_out_t(&gz, NULL, test_sink_write, NULL), 6, 4096, pctx);
+    size_t pos = 0;
+    while(pos < size_t(test_len)) {
+      size_t n = std::min(size_t(rand() % 20000), test_len - pos);
+      ASSERT(zs.feed(&test_str[pos], n));
+      pos += n;
+      if(rand() % 4 == 0) {
+        // everything fed so far can be decompressed from output so far
+        ASSERT(zs.flush());
+        std::string part;
+        GzipStream unz(minigz_out_t(&part, NULL, test_sink_write, NULL), -1, 1000);
+        ASSERT(unz.feed(gz.data(), gz.size()) && unz.flush() && !unz.finish());
+        ASSERT(part == test_str.substr(0, pos));
+      }
+      ASSERT(zs.totalOut() - gz.size() <= 4096);  // buffered output is bounded
+    }
+    ASSERT(zs.finish() && zs.isDone() && zs.totalIn() == size_t(test_len) && zs.totalOut() == gz.size());
+    ASSERT(!zs.feed("x", 1));
+    std::stringstream gz_strm(gz), inf_strm;
+    ASSERT(gunzip(gz_strm, inf_strm) == test_len && inf_strm.str() == test_str);
+
+    // decompress in pieces of random size, including 1 byte pieces through header and footer
+    std::string out;
+    GzipStream unz(minigz_out_t(&out, NULL, test_sink_write, NULL), -1, 1 << 16, pctx);
+    for(pos = 0; pos < gz.size();) {
+      size_t n = std::min(pos < 16 || pos + 16 > gz.size() ? 1 : size_t(rand() % 5000), gz.size() - pos);
+      ASSERT(unz.feed(&gz[pos], n));
+      pos += n;
+    }
+    ASSERT(unz.feed("trailing data", 13));
+    ASSERT(unz.finish() && out == test_str && unz.crc() == miniz_crc32(0, test_str.data(), test_len));
+  }
+
+  // empty input, corrupt data, and not gzip
+  std::string gz, out;
+  GzipStream zs(minigz_out_t(&gz, NULL, test_sink_write, NULL), 1);
+  ASSERT(zs.finish());
+  GzipStream unz(minigz_out_t(&out, NULL, test_sink_write, NULL), -1);
+  ASSERT(unz.feed(gz.data(), gz.size()) && unz.finish() && out.empty());
+
+  std::stringstream src_strm(test_str), gz_strm;
+  gzip(src_strm, gz_strm);
+  std::string bad = gz_strm.str();
+  bad[bad.size() - 6] ^= 1;  // crc
+  GzipStream unz2(minigz_out_t(&out, NULL, test_sink_write, NULL), -1);
+  ASSERT(!unz2.feed(bad.data(), bad.size()) && unz2.isError() && !unz2.finish());
+  GzipStream unz3(minigz_out_t(&out, NULL, test_sink_write, NULL), -1);
+  ASSERT(!unz3.feed("not a gzip file", 15));
+}
+
+// DOC: v2 block gzip, w/ index in trailing gzip members or in sidecar
+void test_bgz_v2(int test_len)
+{
+  std::string test_str = make_test_str(test_len);
+  size_t block_size = test_len/3000;  // index spans 2 members
+  size_t nblocks = (test_len + block_size - 1)/block_size;
+  std::stringstream src_strm(test_str), def_strm, v1_strm, inf_strm;
+  ASSERT(bgz_write_parallel(src_strm, def_strm, block_size, 6 | MINIZ_GZ_BGZ_V2, 2) == test_len);
+  src_strm.clear();
+  src_strm.seekg(0);
+  ASSERT(bgz_write_parallel(src_strm, v1_strm, block_size, 6, 1, 4094) == test_len);
+  // still a valid gzip file (index members are empty)
+  def_strm.seekg(0);
+  ASSERT(gunzip(def_strm, inf_strm) == test_len && inf_strm.str() == test_str);
+  ASSERT(bgz_version(def_strm) == 2 && bgz_version(v1_strm) == 1 && bgz_get_index(def_strm).empty());
+
+  // same blocks as v1, offset by difference in header size
+  std::vector<bgz_block_info64_t> idx2 = bgz_get_index64(def_strm), idx1 = bgz_get_index64(v1_strm);
+  ASSERT(idx2.size() == nblocks + 1 && idx1.size() == nblocks + 1);
+  for(size_t ii = 0; ii <= nblocks; ++ii) {
+    ASSERT(idx2[ii].offset - idx2[0].offset == idx1[ii].offset - idx1[0].offset);
+    ASSERT(idx2[ii].len_cum == idx1[ii].len_cum && idx2[ii].crc32_cum == idx1[ii].crc32_cum);
+  }
+  BgzReader reader(def_strm, 4, 1);
+  std::vector<char> buf(test_len);
+  ASSERT(reader.numBlocks() == nblocks && reader.read(0, test_len, buf.data()) == test_len);
+  ASSERT(std::string(buf.data(), test_len) == test_str);
+  for(int ii = 0; ii < 100; ++ii) {
+    size_t pos = rand() % test_len, len = rand() % (4*block_size);
+    int64_t n = reader.read(pos, len, buf.data());
+    ASSERT(n == int(std::min(len, test_len - pos)) && memcmp(buf.data(), &test_str[pos], n) == 0);
+  }
+
+  // append to v2 file w/ trailing index
+  std::string bgz = def_strm.str();
+  MemStream strm(bgz.data(), bgz.size());
+  {
+    BgzWriter writer{minigz_io_t(strm)};
+    ASSERT(writer.open() && writer.isV2() && writer.numBlocks() == nblocks);
+    ASSERT(writer.write(test_str.data(), 1000) && writer.close());
+  }
+  {
+    std::stringstream gz_strm(std::string(strm.data(), strm.size())), inf2_strm;
+    ASSERT(gunzip(gz_strm, inf2_strm) == test_len + 1000);
+    ASSERT(inf2_strm.str() == test_str + test_str.substr(0, 1000));
+    BgzReader reader2(gz_strm);
+    ASSERT(reader2.numBlocks() == nblocks + 1 && reader2.read(test_len, 2000, buf.data()) == 1000);
+    ASSERT(memcmp(buf.data(), test_str.data(), 1000) == 0);
+  }
+
+  // index in sidecar
+  MemStream strm2, side_strm;
+  minigz_io_t side_io(side_strm);
+  {
+    BgzWriter writer(minigz_io_t(strm2), 6, &side_io);
+    ASSERT(writer.createV2());
+    for(size_t pos = 0; pos < size_t(test_len); pos += test_len/4)
+      ASSERT(writer.write(&test_str[pos], std::min(size_t(test_len/4), test_len - pos)));
+    ASSERT(writer.close());
+  }
+  ASSERT(side_strm.size() > 0);
+  {
+    ConstMemStream rd_strm(strm2.data(), strm2.size()), rd_side(side_strm.data(), side_strm.size());
+    minigz_io_t rd_side_io(rd_side);
+    ASSERT(!BgzReader(minigz_io_t(rd_strm)).isValid());
+    BgzReader reader2(minigz_io_t(rd_strm), 4, 1, &rd_side_io);
+    ASSERT(reader2.numBlocks() == 4 && reader2.read(0, test_len, buf.data()) == test_len);
+    ASSERT(std::string(buf.data(), test_len) == test_str);
+  }
+  {
+    BgzWriter writer(minigz_io_t(strm2), 6, &side_io);
+    ASSERT(writer.open() && writer.isV2() && writer.truncate(1) && writer.close());
+  }
+  {
+    std::stringstream gz_strm(std::string(strm2.data(), strm2.size())), inf2_strm;
+    ASSERT(gunzip(gz_strm, inf2_strm) == test_len/4 && inf2_strm.str() == test_str.substr(0, test_len/4));
+  }
+}
+
 // profiling code from https://github.com/vurtun/lib
 #include <time.h>
 #include <sys/time.h>
@@ -569,89 +2475,239 @@ static double profiler_time(struct timespec start, struct timespec stop)
   return accum;
 }
 
-static void get_time(struct timespec* ts) { clock_gettime(CLOCK_REALTIME, ts); }
+static void get_time(struct timespec* ts) { clock_gettime(CLOCK_MONOTONIC, ts); }
 
-int profile_main(int argc, char **argv)
+// returns best time in ms of reps runs of fn
+template<class F>
+static double bench_time(int reps, F fn)
 {
-  void *comp = 0;
-  size_t size = 0;
-  struct timespec compr_started;
-  struct timespec compr_ended;
-  struct timespec decompr_started;
-  struct timespec decompr_ended;
-  double compr_mbs = 0;
-  double decompr_mbs = 0;
-  void *decomp;
-  double ratio = 0.0f;
-  unsigned long len = 0, n, lvl;
+  double best = 0;
+  for(int ii = 0; ii < reps; ++ii) {
+    struct timespec t0, t1;
+    get_time(&t0);
+    fn();
+    get_time(&t1);
+    double ms = profiler_time(t0, t1);
+    if(ii == 0 || ms < best) best = ms;
+  }
+  return std::max(best, 1E-6);
+}
 
-  void *data = 0;
-  {
-    FILE* fp = fopen(argv[1], "rb");
-    if (!fp) exit(2);
-    fseek(fp, 0, SEEK_END);
-    size = (size_t)ftell(fp);
-    fseek(fp, 0, SEEK_SET);
-    data = calloc(size, 1);
-    fread(data, 1, (size_t)size, fp);
-    fclose(fp);
-  }
-
-  comp = calloc(size*2, 1);
-  decomp = calloc(size, 1);
-  for (lvl = 1; lvl < 10; ++lvl) {
-    len = 2*size;
-    get_time(&compr_started);
-    if(mz_compress2((unsigned char*)comp, &len, (unsigned char*)data, size, lvl) != MZ_OK) {
-      printf("mz_compress2 error!");
-      break;
-    }
-    //len = sdeflate(&sdefl, comp, data, (int)size, lvl);
-    get_time(&compr_ended);
+// benchmark of all gzip APIs over synthetic data and files; one JSON object per line on stdout
+static void bench_print(const char* input, size_t size, const char* bench, const char* api, int level,
+    size_t param, double ratio, double comp_ms, double decomp_ms)
+{
+  printf("{\"input\": \"%s\", \"size\": %llu, \"bench\": \"%s\", \"api\": \"%s\", \"level\": %d, \"param\": %llu, "
+      "\"ratio\": %.4f, \"comp_MBps\": %.2f, \"decomp_MBps\": %.2f}\n", input, (unsigned long long)size, bench, api,
+      level, (unsigned long long)param, ratio, comp_ms > 0 ? size/(1000*comp_ms) : 0,
+      decomp_ms > 0 ? size/(1000*decomp_ms) : 0);
+  fflush(stdout);
+}
 
-    n = size;
-    get_time(&decompr_started);
-    //n = sinflate(decomp, (int)size, comp, len);
-    if(mz_uncompress((unsigned char*)decomp, &n, (unsigned char*)comp, len) != MZ_OK) {
-      printf("mz_uncompress error!");
-      break;
+void bench_input(const char* name, const std::string& data, int reps)
+{
+  size_t size = data.size();
+  std::vector<uint8_t> comp(std::max(gzip_bound(size), size + size/8) + 1024);
+  std::vector<char> out(size);
+  minigz_ctx_t ctx;
+  typedef int (*gz_fn_t)(const void*, size_t, void*, size_t, int, minigz_ctx_t*);
+  typedef int (*gunz_fn_t)(const void*, size_t, void*, size_t, minigz_ctx_t*);
+  struct { const char* name; gz_fn_t gz; gunz_fn_t gunz; } codecs[] = {
+    {"miniz", gzip_mem_miniz, gunzip_mem_miniz},
+#ifdef MINIZ_GZ_USE_LIBDEFLATE
+    {"libdeflate", gzip_mem_libdeflate, gunzip_mem_libdeflate},
+#endif
+  };
+
+  for(int level : {1, 6, 9}) {
+    // miniz w/o gzip wrapper as reference
+    mz_ulong n = 0;
+    double tc = bench_time(reps, [&](){ n = comp.size();
+        mz_compress2(comp.data(), &n, (const uint8_t*)data.data(), size, level); });
+    double td = bench_time(reps, [&](){ mz_ulong m = size;
+        mz_uncompress((uint8_t*)out.data(), &m, comp.data(), n); });
+    bench_print(name, size, "gzip", "mz_compress2", level, 0, double(n)/size, tc, td);
+
+    int nspan = 0;
+    tc = bench_time(reps, [&](){ nspan = gzip(data.data(), size, comp.data(), comp.size(), level, &ctx); });
+    td = bench_time(reps, [&](){ gunzip(comp.data(), nspan, out.data(), size, &ctx); });
+    bench_print(name, size, "gzip", "span", level, 0, double(nspan)/size, tc, td);
+
+    // each compiled in codec (span API uses libdeflate if available), and bgz w/ each block codec
+    for(auto& codec : codecs) {
+      tc = bench_time(reps, [&](){ nspan = codec.gz(data.data(), size, comp.data(), comp.size(), level, &ctx); });
+      td = bench_time(reps, [&](){ codec.gunz(comp.data(), nspan, out.data(), size, &ctx); });
+      bench_print(name, size, "codec", codec.name, level, 0, double(nspan)/size, tc, td);
+    }
+    for(int flags : {0, MINIZ_GZ_ZSTD}) {
+#ifndef MINIZ_GZ_USE_ZSTD
+      if(flags) break;
+#endif
+      std::string bgz;
+      tc = bench_time(reps, [&](){ std::stringstream src_strm(data), def_strm;
+          bgz_write_parallel(src_strm, def_strm, 1 << 20, level | flags, 1, 4094); bgz = def_strm.str(); });
+      ConstMemStream bgz_strm(bgz.data(), bgz.size());
+      td = bench_time(reps, [&](){ BgzReader reader(minigz_io_t(bgz_strm), 1, 1); reader.read(0, size, out.data()); });
+      bench_print(name, size, "codec", flags ? "bgz_zstd" : "bgz_deflate", level, 0, double(bgz.size())/size, tc, td);
     }
-    get_time(&decompr_ended);
 
-    double compr_time = profiler_time(compr_started, compr_ended);
-    double decompr_time = profiler_time(decompr_started, decompr_ended);
+    // stream callbacks: std::iostream vs. fileutil MemStream (readp)
+    std::string gz;
+    tc = bench_time(reps, [&](){ std::stringstream src_strm(data), def_strm;
+        gzip(src_strm, def_strm, level, &ctx); gz = def_strm.str(); });
+    td = bench_time(reps, [&](){ std::stringstream def_strm(gz), inf_strm; gunzip(def_strm, inf_strm, &ctx); });
+    bench_print(name, size, "gzip", "stringstream", level, 0, double(gz.size())/size, tc, td);
+
+    tc = bench_time(reps, [&](){ ConstMemStream src_strm(data.data(), size); MemStream def_strm;
+        gzip(minigz_io_t(src_strm), minigz_io_t(def_strm), level, &ctx); gz.assign(def_strm.data(), def_strm.size()); });
+    td = bench_time(reps, [&](){ ConstMemStream def_strm(gz.data(), gz.size()); MemStream inf_strm;
+        gunzip(minigz_io_t(def_strm), minigz_io_t(inf_strm), &ctx); });
+    bench_print(name, size, "gzip", "memstream", level, 0, double(gz.size())/size, tc, td);
+
+    // push API, fed 64KB at a time
+    const size_t feedlen = 1 << 16;
+    tc = bench_time(reps, [&](){ gz.clear();
+        GzipStream zs(minigz_out_t(&gz, NULL, test_sink_write, NULL), level, 1 << 16, &ctx);
+        for(size_t pos = 0; pos < size; pos += feedlen) zs.feed(&data[pos], std::min(feedlen, size - pos));
+        zs.finish(); });
+    td = bench_time(reps, [&](){ std::string inf;
+        GzipStream zs(minigz_out_t(&inf, NULL, test_sink_write, NULL), -1, 1 << 16, &ctx);
+        for(size_t pos = 0; pos < gz.size(); pos += feedlen) zs.feed(&gz[pos], std::min(feedlen, gz.size() - pos));
+        zs.finish(); });
+    bench_print(name, size, "gzip", "GzipStream", level, feedlen, double(gz.size())/size, tc, td);
+  }
+
+  // chunkSize effect on stream APIs
+  size_t chunk0 = chunkSize;
+  for(size_t chunk : {size_t(4 << 10), size_t(16 << 10), size_t(64 << 10), size_t(256 << 10), size_t(1 << 20), size_t(4 << 20)}) {
+    chunkSize = chunk;
+    std::string gz;
+    double tc = bench_time(reps, [&](){ ConstMemStream src_strm(data.data(), size); MemStream def_strm;
+        gzip(minigz_io_t(src_strm), minigz_io_t(def_strm), 6, &ctx); gz.assign(def_strm.data(), def_strm.size()); });
+    double td = bench_time(reps, [&](){ ConstMemStream def_strm(gz.data(), gz.size()); MemStream inf_strm;
+        gunzip(minigz_io_t(def_strm), minigz_io_t(inf_strm), &ctx); });
+    bench_print(name, size, "chunk_size", "memstream", 6, chunk, double(gz.size())/size, tc, td);
+  }
+  chunkSize = chunk0;
+
+  // many small inputs w/ and w/o reused minigz_ctx_t
+  const size_t itemlen = 2000;
+  std::vector<std::string> items(std::min(size/itemlen, size_t(2000)));
+  for(minigz_ctx_t* pctx : {(minigz_ctx_t*)NULL, &ctx}) {
+    if(items.empty()) break;
+    size_t total = 0;
+    double tc = bench_time(reps, [&](){ total = 0;
+        for(size_t ii = 0; ii < items.size(); ++ii) {
+          ConstMemStream src_strm(&data[ii*itemlen], itemlen); MemStream def_strm;
+          gzip(minigz_io_t(src_strm), minigz_io_t(def_strm), 6, pctx);
+          items[ii].assign(def_strm.data(), def_strm.size());
+          total += items[ii].size();
+        } });
+    double td = bench_time(reps, [&](){ for(const std::string& gz : items) {
+          ConstMemStream def_strm(gz.data(), gz.size()); MemStream inf_strm;
+          gunzip(minigz_io_t(def_strm), minigz_io_t(inf_strm), pctx);
+        } });
+    bench_print(name, items.size()*itemlen, "small_items", pctx ? "ctx" : "no_ctx", 6, itemlen,
+        double(total)/(items.size()*itemlen), tc, td);
+  }
+
+  // crc32 over input in len byte pieces (comp_MBps is crc throughput)
+  typedef uint32_t (*crc_fn_t)(uint32_t, const uint8_t*, size_t);
+  static crc_fn_t mz = [](uint32_t c, const uint8_t* p, size_t n) { return uint32_t(mz_crc32(c, p, n)); };
+  static crc_fn_t mc = [](uint32_t c, const uint8_t* p, size_t n) { return miniz_crc32(c, p, n); };
+  struct { const char* name; crc_fn_t volatile fn; } crcfns[] = {{"mz_crc32", mz}, {"slice8", crc32_slice8},
+#ifdef CRC32_FOLD
+      {"miniz_crc32_fold", mc}};
+#else
+      {"miniz_crc32", mc}};
+#endif
+  for(size_t len : {size_t(64), size_t(1024), size_t(16384), size_t(1 << 20)}) {
+    for(auto& f : crcfns) {
+      const uint8_t* p = (const uint8_t*)data.data();
+      double tc = bench_time(reps, [&](){ uint32_t crc = MZ_CRC32_INIT;
+          for(size_t pos = 0; pos < size; pos += len) crc = f.fn(crc, p + pos, std::min(len, size - pos)); });
+      bench_print(name, size, "crc32", f.name, 0, len, 0, tc, 0);
+    }
+  }
 
-    ratio = (double)len / (double)size * 100.0;
-    compr_mbs = ((double)size / 1000000.0f) / (compr_time / 1000.0f);
-    decompr_mbs = ((double)size / 1000000.0f) / (decompr_time / 1000.0f);
+  // bgz: write, then random 4KB reads (decomp_MBps is for bytes returned) w/ BgzReader vs. bgz_read_block for
+  //  each read, and whole file sequential read
+  const int nreads = 1000;
+  const size_t readlen = 4096;
+  std::vector<size_t> offsets(nreads);
+  for(size_t& off : offsets)
+    off = size > readlen ? rand() % (size - readlen) : 0;
+  for(size_t block_size : {size_t(64 << 10), size_t(256 << 10), size_t(1 << 20)}) {
+    std::string bgz;
+    double tc = bench_time(reps, [&](){ std::stringstream src_strm(data), def_strm;
+        bgz_write_parallel(src_strm, def_strm, block_size, 6 | MINIZ_GZ_BGZ_V2, 1); bgz = def_strm.str(); });
+    ConstMemStream bgz_strm(bgz.data(), bgz.size());
+    double td = bench_time(reps, [&](){ BgzReader reader(minigz_io_t(bgz_strm), 8, 1);
+        for(size_t off : offsets) reader.read(off, readlen, out.data()); });
+    bench_print(name, nreads*std::min(readlen, size), "bgz_random", "BgzReader", 6, block_size,
+        double(bgz.size())/size, 0, td);
+    std::vector<bgz_block_info64_t> index = bgz_get_index64(minigz_io_t(bgz_strm));
+    td = bench_time(reps, [&](){ for(size_t off : offsets) {
+          size_t idx = std::upper_bound(index.begin() + 1, index.end(), off,
+              [](size_t o, const bgz_block_info64_t& b) { return o < b.len_cum; }) - index.begin() - 1;
+          MemStream inf_strm;
+          bgz_read_block(minigz_io_t(bgz_strm), &index[idx], minigz_io_t(inf_strm));
+        } });
+    bench_print(name, nreads*std::min(readlen, size), "bgz_random", "bgz_read_block", 6, block_size,
+        double(bgz.size())/size, 0, td);
+    td = bench_time(reps, [&](){ BgzReader reader(minigz_io_t(bgz_strm), 1, 1); reader.read(0, size, out.data()); });
+    bench_print(name, size, "bgz_sequential", "BgzReader", 6, block_size, double(bgz.size())/size, tc, td);
+  }
 
-    printf("lvl: %d size: %d, compr: %.2fms (%.2fMB/s) decompr: %.2fms (%.2fMB/s) ratio: %f%% ", lvl, len, compr_time, compr_mbs, decompr_time, decompr_mbs, ratio);
-    if ((size_t)n != size || memcmp(data, decomp, (size_t)size)) {
-      //FILE *fd = fopen("error.bin", "wb");
-      //fwrite(decomp, 1, (size_t)n, fd);
-      //fclose(fd);
+  // bgz_write_parallel and BgzReader read ahead scaling w/ number of threads; block size gives >= 64 blocks
+  //  (unless input is tiny) so every thread has work
+  const size_t thread_block_size = std::max(size/64, size_t(4096));
+  for(int nthreads : {1, 2, 4, 8, 16, 32}) {
+    std::string bgz;
+    double tc = bench_time(reps, [&](){ std::stringstream src_strm(data), def_strm;
+        bgz_write_parallel(src_strm, def_strm, thread_block_size, 6, nthreads, 4094); bgz = def_strm.str(); });
+    ConstMemStream bgz_strm(bgz.data(), bgz.size());
+    double td = bench_time(reps, [&](){ BgzReader reader(minigz_io_t(bgz_strm), nthreads + 1, nthreads);
+        reader.read(0, size, out.data()); });
+    bench_print(name, size, "bgz_threads", "bgz_write_parallel", 6, nthreads, double(bgz.size())/size, tc, td);
+  }
+}
 
-      printf("error: %d:%d !\n", n, (int)size);
-      break;
+// corpus is synthetic text, random bytes, and any files passed
+int bench_main(const std::vector<std::string>& files, int reps)
+{
+  std::string noise(4 << 20, '\0');
+  for(char& c : noise) c = char(rand());
+  bench_input("synthetic_text", make_test_str(4 << 20), reps);
+  bench_input("random", noise, reps);
+  for(const std::string& file : files) {
+    std::ifstream f(file.c_str(), std::ios::binary);
+    if(!f) {
+      fprintf(stderr, "Unable to open %s\n", file.c_str());
+      return -1;
     }
-    else printf("\n");
+    bench_input(file.c_str(), std::string(std::istreambuf_iterator<char>(f), {}), reps);
   }
   return 0;
 }
 
 int main(int argc, char* argv[])
 {
+  if(argc > 1 && strcmp(argv[1], "--bench") == 0) {
+    return bench_main(std::vector<std::string>(argv + 2, argv + argc), 3);
+  }
   if(argc > 1) {
     std::fstream f(argv[1], std::fstream::in | std::fstream::binary);
-    std::vector<bgz_block_info_t> block_info = bgz_get_index(f);
+    std::vector<bgz_block_info64_t> block_info = bgz_get_index64(f);  // v1 or v2
     if(!block_info.empty()) {
       int ii = 0;
       for(auto& b : block_info)
-        printf("block %d: offset %d, cum_len: %d\n", ii++, b.offset, b.len_cum);
+        printf("block %d: offset %llu, cum_len: %llu\n", ii++, (unsigned long long)b.offset,
+            (unsigned long long)b.len_cum);
     }
     else {
-      printf("No gzip blocks found, profiling instead.\n\n");
-      profile_main(argc, argv);
+      fprintf(stderr, "No gzip blocks found, benchmarking instead.\n");  // keep stdout JSON lines only
+      bench_main(std::vector<std::string>(1, argv[1]), 3);
     }
     return 0;
   }
@@ -671,6 +2727,20 @@ int main(int argc, char* argv[])
   test_chunk_sizes(100000);
 
   test_level0_block(100000);
+
+  test_base64_gzip(100000);
+
+  test_crc32();
+  test_gzip_ctx();
+  test_gzip_mem(100000);
+  test_codecs(100000);
+
+  test_bgz_parallel(100000);
+  test_bgz_reader(100000);
+  test_bgz_writer(100000);
+  test_bgz_v2(100000);
+  test_gzip_stream(100000);
+  test_bgz_adaptive(100000);
   return 0;
 }
 
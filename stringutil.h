@@ -3,11 +3,18 @@
 
 #include <limits.h>
 #include <string.h>
+#include <stdint.h>
 #include <algorithm>
+#include <limits>
+#include <cmath>
+#include <type_traits>
 #include <vector>
 #include <string>
 #include <sstream>
 #include <random>
+#include <atomic>
+#include <mutex>
+#include <functional>
 
 #include "stb_sprintf.h"
 
@@ -20,6 +27,12 @@
 #define strtoull _strtoui64
 #define strncasecmp _strnicmp
 #define strcasecmp _stricmp
+#include <intrin.h>  // _umul128, _BitScanForward64
+#endif
+
+// compile-time perfect hash and FMT() format strings require C++14 (relaxed constexpr)
+#if __cplusplus >= 201402L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201402L)
+#define STRINGUTIL_CPP14 1
 #endif
 
 // split std::string on delimiter - http://stackoverflow.com/questions/236129/how-to-split-a-string-in-c
@@ -69,21 +82,6 @@ Container<char*, Container_Params... > splitStrInPlace(char* str, const char* se
 }
 
 // accept vector of anything that can be written to stringstream
-template<typename T>
-std::string joinStr(const std::vector<T>& strs, const char* sep)
-{
-  std::stringstream ss;
-  if(!strs.empty())
-    ss << strs[0];
-  for(size_t ii = 1; ii < strs.size(); ++ii)
-    ss << sep << strs[ii];
-  return ss.str();
-}
-
-// optimized specialization for std::string
-template<>
-std::string joinStr(const std::vector<std::string>& strs, const char* sep);
-
 std::string fstring(const char* fmt, ...);
 //inline std::string fstring(const char* fmt) { return fmt;  }
 
@@ -164,8 +162,15 @@ public:
   // const char* c_str(char* buff) const { if(!str[len]) return str; strncpy(buff, str, len); buff[len] = '\0'; return buff; }
 
   friend StringRef operator+(const StringRef& ref, int inc) { return StringRef(ref) += inc; }
+  // single pass w/o strlen(other)
   friend bool operator==(const StringRef& ref, const char* other)
-    { return ref.len == strlen(other) && strncmp(ref.str, other, ref.len) == 0; }
+  {
+    for(size_t ii = 0; ii < ref.len; ++ii) {
+      if(other[ii] != ref.str[ii] || !other[ii])
+        return false;
+    }
+    return other[ref.len] == '\0';
+  }
   friend bool operator==(const StringRef& ref, const StringRef& other)
     { return ref.len == other.len && strncmp(ref.str, other.str, ref.len) == 0; }
   friend bool operator!=(const StringRef& ref, const char* other) { return !operator==(ref, other); }
@@ -178,6 +183,304 @@ const char* findWord(const char* str, const char* word, char sep = ' ');
 inline bool containsWord(const char* str, const char* word, char sep = ' ') { return findWord(str, word, sep) != NULL; }
 std::string addWord(std::string s, std::string w, char sep = ' ');
 std::string removeWord(std::string s, std::string w, char sep = ' ');
+
+// wyhash (final version 4) by Wang Yi - fast, high quality 64-bit hash; seed can be used to select hash fn
+inline void wymum(uint64_t& a, uint64_t& b)
+{
+#if defined(__SIZEOF_INT128__)
+  __uint128_t r = __uint128_t(a)*b;
+  a = uint64_t(r);
+  b = uint64_t(r >> 64);
+#elif defined(_MSC_VER) && defined(_M_X64)
+  a = _umul128(a, b, &b);
+#else
+  uint64_t ha = a >> 32, hb = b >> 32, la = uint32_t(a), lb = uint32_t(b);
+  uint64_t rh = ha*hb, rm0 = ha*lb, rm1 = hb*la, rl = la*lb, t = rl + (rm0 << 32);
+  uint64_t lo = t + (rm1 << 32);
+  b = rh + (rm0 >> 32) + (rm1 >> 32) + (t < rl) + (lo < t);
+  a = lo;
+#endif
+}
+
+inline uint64_t wymix(uint64_t a, uint64_t b) { wymum(a, b); return a ^ b; }
+
+inline uint64_t wyhash(const void* key, size_t len, uint64_t seed = 0)
+{
+  static const uint64_t wyp[4] = {0x2d358dccaa6c78a5ull, 0x8bb84b93962eacc9ull, 0x4b33a62ed433d4a3ull, 0x4d5a2da51de1aa47ull};
+  auto r8 = [](const unsigned char* p) { uint64_t v; memcpy(&v, p, 8); return v; };
+  auto r4 = [](const unsigned char* p) { uint32_t v; memcpy(&v, p, 4); return uint64_t(v); };
+  const unsigned char* p = (const unsigned char*)key;
+  seed ^= wymix(seed ^ wyp[0], wyp[1]);
+  uint64_t a, b;
+  if(len <= 16) {
+    if(len >= 4) {
+      a = (r4(p) << 32) | r4(p + ((len >> 3) << 2));
+      b = (r4(p + len - 4) << 32) | r4(p + len - 4 - ((len >> 3) << 2));
+    }
+    else if(len > 0) {
+      a = (uint64_t(p[0]) << 16) | (uint64_t(p[len >> 1]) << 8) | p[len - 1];
+      b = 0;
+    }
+    else
+      a = b = 0;
+  }
+  else {
+    size_t ii = len;
+    if(ii >= 48) {
+      uint64_t see1 = seed, see2 = seed;
+      do {
+        seed = wymix(r8(p) ^ wyp[1], r8(p + 8) ^ seed);
+        see1 = wymix(r8(p + 16) ^ wyp[2], r8(p + 24) ^ see1);
+        see2 = wymix(r8(p + 32) ^ wyp[3], r8(p + 40) ^ see2);
+        p += 48;
+        ii -= 48;
+      } while(ii >= 48);
+      seed ^= see1 ^ see2;
+    }
+    while(ii > 16) {
+      seed = wymix(r8(p) ^ wyp[1], r8(p + 8) ^ seed);
+      ii -= 16;
+      p += 16;
+    }
+    a = r8(p + ii - 16);
+    b = r8(p + ii - 8);
+  }
+  a ^= wyp[1];
+  b ^= seed;
+  wymum(a, b);
+  return wymix(a ^ wyp[0] ^ len, b ^ wyp[1]);
+}
+
+inline uint64_t wyhash(const StringRef& s, uint64_t seed = 0) { return wyhash(s.data(), s.size(), seed); }
+
+struct Hash128
+{
+  uint64_t lo, hi;
+  friend bool operator==(const Hash128& a, const Hash128& b) { return a.lo == b.lo && a.hi == b.hi; }
+  friend bool operator!=(const Hash128& a, const Hash128& b) { return !(a == b); }
+};
+
+// fastHash: non-cryptographic 64/128-bit hash for hash tables and cache keys - same as wyhash for len <= 256;
+//  longer inputs use XXH3-style wide accumulator (8 x 64-bit lanes, SIMD w/ AVX2 or SSE2)
+uint64_t fastHash64(const void* data, size_t len, uint64_t seed = 0);
+Hash128 fastHash128(const void* data, size_t len, uint64_t seed = 0);
+inline uint64_t fastHash64(const StringRef& s, uint64_t seed = 0) { return fastHash64(s.data(), s.size(), seed); }
+
+// streaming fastHash - result is identical to one-shot fastHash64/128 for the same data, however split
+class FastHasher
+{
+public:
+  FastHasher(uint64_t _seed = 0) { reset(_seed); }
+  void reset(uint64_t _seed = 0);
+  FastHasher& update(const void* data, size_t len);
+  FastHasher& update(const StringRef& s) { return update(s.data(), s.size()); }
+  uint64_t hash64() const;
+  Hash128 hash128() const;
+  uint64_t totalLen() const { return total; }
+
+private:
+  enum { PREV_SIZE = 64, BUFF_SIZE = 256 };
+  uint64_t acc[8];
+  uint64_t key[24];
+  uint64_t seed;
+  uint64_t total;
+  size_t nbuff;
+  size_t nstripes;  // stripes consumed in current block
+  // last stripe of consumed data followed by pending data - needed since final stripe can span both
+  unsigned char buff[PREV_SIZE + BUFF_SIZE];
+
+  void finish(uint64_t* lo, uint64_t* hi) const;
+};
+
+namespace std {
+template<> struct hash<StringRef>
+{
+  size_t operator()(const StringRef& s) const { return size_t(fastHash64(s)); }
+};
+}
+
+// Global thread-safe atom table: interned strings w/ stable small integer IDs starting from 1 (so 0 can mean
+//  "none"); lookups are lock-free, only interning of a new string takes a lock
+int atomId(const StringRef& str);  // interns str if not already present
+int findAtom(const StringRef& str);  // returns 0 if str has not been interned
+StringRef atomStr(int id);  // interned string, valid for life of program (NUL terminated)
+
+// Compile-time perfect hash for fixed keyword sets (hash and displace): each keyword maps to a distinct slot,
+//  so lookup is one hash and one string compare; find() returns index of keyword in array or -1, allowing
+//  dispatch via switch:
+//  static constexpr const char* cssProps[] = {"color", "width", ...};
+//  static constexpr auto cssPropHash = makePerfectHash(cssProps);
+//  static_assert(cssPropHash.valid, "perfect hash generation failed");  -- only fails for duplicate keywords
+//  switch(cssPropHash.find(name)) { case cssPropHash.index("color"): ... }
+#ifdef STRINGUTIL_CPP14
+constexpr uint64_t phHash(const char* s, size_t len)
+{
+  uint64_t h = 0xcbf29ce484222325ull;  // FNV-1a
+  for(size_t ii = 0; ii < len; ++ii)
+    h = (h ^ (unsigned char)s[ii]) * 0x100000001b3ull;
+  return h;
+}
+
+constexpr uint32_t phMix(uint64_t h, uint32_t d)
+{
+  h ^= d*0x9E3779B97F4A7C15ull;
+  h = (h ^ (h >> 31)) * 0xBF58476D1CE4E5B9ull;
+  return uint32_t(h ^ (h >> 29));
+}
+
+constexpr size_t phStrLen(const char* s) { size_t n = 0; while(s[n]) ++n; return n; }
+constexpr size_t phPow2(size_t n) { size_t p = 1; while(p < n) p *= 2; return p; }
+
+template<size_t N, size_t B = phPow2((N + 1)/2), size_t M = phPow2(2*N)>
+struct PerfectHash
+{
+  const char* const* keys;
+  uint32_t disp[B];  // displacement for each bucket
+  int slots[M];  // keyword index or -1
+  bool valid;
+
+  constexpr int find(const char* s, size_t len) const
+  {
+    uint64_t h = phHash(s, len);
+    int idx = slots[phMix(h, disp[h & (B - 1)]) & (M - 1)];
+    if(idx < 0)
+      return -1;
+    const char* k = keys[idx];
+    for(size_t ii = 0; ii < len; ++ii) {
+      if(k[ii] != s[ii] || !k[ii])
+        return -1;
+    }
+    return k[len] == '\0' ? idx : -1;
+  }
+  int find(const StringRef& s) const { return find(s.data(), s.size()); }
+  // for use as case label; returns -1 (so no case matches) if s not in set
+  constexpr int index(const char* s) const { return find(s, phStrLen(s)); }
+};
+
+template<size_t N, size_t B = phPow2((N + 1)/2), size_t M = phPow2(2*N)>
+constexpr PerfectHash<N, B, M> makePerfectHash(const char* const (&keys)[N])
+{
+  PerfectHash<N, B, M> ph{};
+  ph.keys = keys;
+  ph.valid = true;
+  uint64_t hashes[N]{};
+  size_t bucketSize[B]{};
+  for(size_t ii = 0; ii < N; ++ii) {
+    hashes[ii] = phHash(keys[ii], phStrLen(keys[ii]));
+    ++bucketSize[hashes[ii] & (B - 1)];
+  }
+  for(size_t ii = 0; ii < M; ++ii)
+    ph.slots[ii] = -1;
+  // place largest buckets first
+  for(size_t size = N; size > 0; --size) {
+    for(size_t b = 0; b < B; ++b) {
+      if(bucketSize[b] != size)
+        continue;
+      uint32_t d = 0;
+      for(; d < (1u << 20); ++d) {
+        // try to place all keys in bucket; undo on collision
+        bool ok = true;
+        for(size_t ii = 0; ii < N && ok; ++ii) {
+          if((hashes[ii] & (B - 1)) != b)
+            continue;
+          size_t slot = phMix(hashes[ii], d) & (M - 1);
+          if(ph.slots[slot] >= 0)
+            ok = false;
+          else
+            ph.slots[slot] = int(ii);
+        }
+        if(ok)
+          break;
+        for(size_t ii = 0; ii < M; ++ii) {
+          if(ph.slots[ii] >= 0 && (hashes[ph.slots[ii]] & (B - 1)) == b)
+            ph.slots[ii] = -1;
+        }
+      }
+      if(d == (1u << 20))
+        ph.valid = false;
+      ph.disp[b] = d;
+    }
+  }
+  return ph;
+}
+#endif // STRINGUTIL_CPP14
+
+// Set of words from separator-delimited string (e.g. list of classes) hashed once for O(1) membership tests,
+//  instead of scanning string w/ findWord()/containsWord() for every query
+class WordSet
+{
+public:
+  WordSet(const StringRef& str = StringRef(), char _sep = ' ');
+  bool contains(const StringRef& word) const { return find(word, hash(word)) >= 0; }
+  // for testing same word against many sets, hash can be computed once w/ hash(word)
+  bool contains(const StringRef& word, size_t h) const { return find(word, h) >= 0; }
+  bool add(const StringRef& word);  // returns false if word already present
+  bool remove(const StringRef& word);  // returns false if word not present
+  size_t size() const { return words.size(); }
+  const std::vector<std::string>& list() const { return words; }  // words in order added
+  std::string toString() const;  // words joined by sep
+  static size_t hash(const StringRef& word);
+
+private:
+  int find(const StringRef& word, size_t h) const;
+  void insert(int idx, size_t h);
+  void rehash(size_t n);
+
+  struct Slot { uint32_t hash; int idx; };  // idx into words, or -1 for empty slot
+  std::vector<std::string> words;
+  std::vector<Slot> table;  // open addressing w/ linear probing
+  char sep;
+};
+
+// Aho-Corasick automaton for finding all occurrences of many words (e.g. selector classes) in a string in a
+//  single pass; by default only whole words (delimited by sep or ends of string) are matched
+class WordMatcher
+{
+public:
+  WordMatcher(const std::vector<StringRef>& words = {}) : trie(1), trieWord(1, -1)
+    { for(const StringRef& w : words) add(w); }
+  int add(const StringRef& word);  // returns index of word; automaton rebuilt on next search
+  size_t size() const { return wordLens.size(); }
+  // calls fn(wordIdx, pos) for each match in str; set sep = '\0' to match substrings
+  template<class F> void find(const StringRef& str, F fn, char sep = ' ') const;
+  // indices of matched words (w/ duplicates if word occurs more than once)
+  std::vector<int> findAll(const StringRef& str, char sep = ' ') const;
+  bool containsAny(const StringRef& str, char sep = ' ') const;
+
+private:
+  void build() const;
+  bool isWord(const StringRef& str, size_t start, size_t end, char sep) const
+    { return !sep || ((start == 0 || str[start - 1] == sep) && (end == str.size() || str[end] == sep)); }
+
+  std::vector<int> wordLens;
+  // trie: children of node are stored as (char, node) pairs until automaton is built
+  std::vector<std::vector<std::pair<unsigned char, int>>> trie;
+  std::vector<int> trieWord;  // index of word ending at node, or -1
+  // automaton - mutable since it is built lazily by const search methods
+  mutable bool built = false;
+  mutable unsigned char charClass[256];  // chars not appearing in any word map to class 0
+  mutable int nClasses = 1;
+  mutable std::vector<int> delta;  // transitions: delta[node*nClasses + charClass[c]]
+  mutable std::vector<int> outLink;  // nearest proper suffix node at which a word ends, or 0 (root)
+};
+
+template<class F>
+void WordMatcher::find(const StringRef& str, F fn, char sep) const
+{
+  if(!built)
+    build();
+  int node = 0;
+  for(size_t ii = 0; ii < str.size(); ++ii) {
+    node = delta[node*nClasses + charClass[(unsigned char)str[ii]]];
+    for(int out = trieWord[node] >= 0 ? node : outLink[node]; out > 0; out = outLink[out]) {
+      int w = trieWord[out];
+      size_t start = ii + 1 - wordLens[w];
+      if(isWord(str, start, ii + 1, sep))
+        fn(w, start);
+    }
+  }
+}
+
 char* strNstr(const char* s, const char* substr, size_t len);
 std::string urlEncode(const char* s);
 
@@ -190,6 +493,30 @@ inline std::string base64_encode(const std::string& str) { return base64_encode(
 inline std::string base64_encode(const std::vector<unsigned char>& str) { return base64_encode(str.data(), str.size()); }
 inline std::vector<unsigned char> base64_decode(const std::string& str) { return base64_decode(str.data(), str.size()); }
 
+// incremental base64 encoder and decoder for processing data in chunks of any size
+struct Base64Encoder
+{
+  unsigned char pending[3];
+  size_t npending = 0;
+
+  // dest must have room for maxEncodedLen(len) chars; returns number of chars written
+  size_t encode(const unsigned char* data, size_t len, char* dest);
+  // write remaining bytes w/ padding (up to 4 chars) and reset
+  size_t finish(char* dest);
+  static constexpr size_t maxEncodedLen(size_t len) { return 4 * ((len + 2) / 3); }
+};
+
+struct Base64Decoder
+{
+  unsigned int val = 0;
+  int valb = -8;
+
+  // invalid chars are skipped; dest must have room for maxDecodedLen(len) bytes; returns number of bytes written
+  size_t decode(const char* data, size_t len, unsigned char* dest);
+  void reset() { val = 0; valb = -8; }
+  static constexpr size_t maxDecodedLen(size_t len) { return 3 * ((len + 6) / 4); }  // up to 3 chars pending
+};
+
 inline std::string trimStr(const std::string& s)
 {
   return StringRef(s).trimmed().toString();
@@ -200,7 +527,7 @@ static int indexOfStr(const StringRef& value, const char* const (&strs)[N])
 {
   int ii = 0;
   for(const char* str : strs) {
-    if(str == value)
+    if(value == str)  // StringRef == const char* avoids strlen
       return ii;
     ++ii;
   }
@@ -278,33 +605,375 @@ static Real strToReal(const char *p, char** endptr)
 }
 
 // We should probably have intToStr and realToStr add '\0' terminators
-// std::tostring calls sprintf ... I think this should be a bit faster
+// digit count is computed first so digits can be written in place two at a time from a table, w/o reversing
+inline const char* digitPairs()
+{
+  static const char pairs[] =
+      "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+      "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+      "8081828384858687888990919293949596979899";
+  return pairs;
+}
+
+inline int numDigits(uint64_t x)
+{
+  for(int n = 1;; n += 4, x /= 10000) {
+    if(x < 10) return n;
+    if(x < 100) return n + 1;
+    if(x < 1000) return n + 2;
+    if(x < 10000) return n + 3;
+  }
+}
+
+template<typename UInt>
+int uintToStr(char* str, UInt x)
+{
+  int n = numDigits(x);
+  char* p = str + n;
+  const char* pairs = digitPairs();
+  while(x >= 100) {
+    unsigned int r = unsigned(x % 100);
+    x /= 100;
+    p -= 2;
+    memcpy(p, pairs + 2*r, 2);
+  }
+  if(x >= 10)
+    memcpy(p - 2, pairs + 2*x, 2);
+  else
+    p[-1] = char('0' + x);
+  return n;
+}
+
+// std::tostring calls sprintf ... this is much faster
 template<typename Int>
 int intToStr(char* str, Int x)
 {
-  bool negative = x < 0;
-  if(negative)
-    x = -x;
+  // 32-bit math is faster, so only use 64-bit for larger types
+  typedef typename std::conditional<(sizeof(Int) > 4), uint64_t, uint32_t>::type UInt;
+  if(x < 0) {
+    str[0] = '-';
+    return 1 + uintToStr(str + 1, UInt(0) - UInt(x));  // no overflow for most negative value
+  }
+  return uintToStr(str, UInt(x));
+}
+
+// parse up to 8 digits (already converted from ASCII) packed in little-endian uint64 w/ leading zero bytes
+inline uint32_t swarParse8(uint64_t v)
+{
+  v = v*10 + (v >> 8);
+  v = (((v & 0x000000FF000000FFull) * (100 + (1000000ull << 32)))
+      + (((v >> 16) & 0x000000FF000000FFull) * (1 + (10000ull << 32)))) >> 32;
+  return uint32_t(v);
+}
+
+// Parse integer from [p, end) - no leading whitespace allowed; sign is optional ('-' only for signed types);
+//  returns pointer after last digit, or p if no digits or value doesn't fit in Int (in which case out is not
+//  modified).  Up to 8 digits are parsed at a time using SWAR (on little-endian platforms)
+template<typename Int>
+const char* parseInt(const char* p, const char* end, Int& out)
+{
+  const char* start = p;
+  bool negative = false;
+  if(p < end && (*p == '-' || *p == '+')) {
+    negative = *p++ == '-';
+    if(negative && !std::is_signed<Int>::value)
+      return start;
+  }
+  const char* digits = p;
+  uint64_t val = 0;
+#if !defined(__BYTE_ORDER__) || __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  static const uint32_t pow10[] = {1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000};
+  while(end - p >= 8) {
+    uint64_t v;
+    memcpy(&v, p, 8);
+    // nonzero byte for each non-digit: high nibble must be 3 and low nibble must be < 10
+    uint64_t nondigit = ((v & 0xF0F0F0F0F0F0F0F0ull) ^ 0x3030303030303030ull)
+        | (((v + 0x0606060606060606ull) & 0xF0F0F0F0F0F0F0F0ull) ^ 0x3030303030303030ull);
+#ifdef _MSC_VER
+    unsigned long nz;
+    int n = nondigit && _BitScanForward64(&nz, nondigit) ? int(nz >> 3) : 8;
+#else
+    int n = nondigit ? __builtin_ctzll(nondigit) >> 3 : 8;
+#endif
+    if(n == 0)
+      break;
+    // borrows from non-digits only propagate to following bytes, which are shifted out
+    uint32_t d = swarParse8((v - 0x3030303030303030ull) << (8*(8 - n)));
+    if(val >= 184467440737ull && val > (UINT64_MAX - d)/pow10[n])
+      return start;  // overflow
+    val = val*pow10[n] + d;
+    p += n;
+    if(n < 8)
+      break;
+  }
+#endif
+  for(; p < end && *p >= '0' && *p <= '9'; ++p) {
+    unsigned int d = *p - '0';
+    if(val >= 1844674407370955161ull && val > (UINT64_MAX - d)/10)
+      return start;
+    val = val*10 + d;
+  }
+  if(p == digits)
+    return start;
+  typedef typename std::make_unsigned<Int>::type UInt;
+  uint64_t maxval = uint64_t(std::numeric_limits<Int>::max()) + (negative ? 1 : 0);
+  if(val > maxval)
+    return start;
+  out = negative ? Int(UInt(0) - UInt(val)) : Int(val);
+  return p;
+}
+
+// Shortest round-trip float to string conversion using Grisu2 (Loitsch, "Printing Floating-Point Numbers
+//  Quickly and Accurately with Integers") - based on dtoa_impl in https://github.com/nlohmann/json
+// Grisu2 output always round-trips and is the shortest possible for all but a tiny fraction of inputs
+struct DiyFp
+{
+  uint64_t f;
+  int e;
 
+  static DiyFp mul(const DiyFp& x, const DiyFp& y)
+  {
+    // 64x64 -> upper 64 bits of 128-bit product, rounded
+    uint64_t u_lo = x.f & 0xFFFFFFFFu, u_hi = x.f >> 32;
+    uint64_t v_lo = y.f & 0xFFFFFFFFu, v_hi = y.f >> 32;
+    uint64_t p0 = u_lo*v_lo, p1 = u_lo*v_hi, p2 = u_hi*v_lo, p3 = u_hi*v_hi;
+    uint64_t q = (p0 >> 32) + (p1 & 0xFFFFFFFFu) + (p2 & 0xFFFFFFFFu) + (1u << 31);
+    return {p3 + (p1 >> 32) + (p2 >> 32) + (q >> 32), x.e + y.e + 64};
+  }
+
+  static DiyFp normalize(DiyFp x) { while(!(x.f >> 63)) { x.f <<= 1; --x.e; } return x; }
+};
+
+// cached powers of 10 (normalized significand, binary exponent, decimal exponent) for 10^-300 to 10^324
+inline DiyFp grisu2_cached_power(int e, int* k)
+{
+  static const struct { uint64_t f; int e; int k; } cachedPowers[] = {
+    { 0xAB70FE17C79AC6CA, -1060, -300 }, { 0xFF77B1FCBEBCDC4F, -1034, -292 }, { 0xBE5691EF416BD60C, -1007, -284 },
+    { 0x8DD01FAD907FFC3C,  -980, -276 }, { 0xD3515C2831559A83,  -954, -268 }, { 0x9D71AC8FADA6C9B5,  -927, -260 },
+    { 0xEA9C227723EE8BCB,  -901, -252 }, { 0xAECC49914078536D,  -874, -244 }, { 0x823C12795DB6CE57,  -847, -236 },
+    { 0xC21094364DFB5637,  -821, -228 }, { 0x9096EA6F3848984F,  -794, -220 }, { 0xD77485CB25823AC7,  -768, -212 },
+    { 0xA086CFCD97BF97F4,  -741, -204 }, { 0xEF340A98172AACE5,  -715, -196 }, { 0xB23867FB2A35B28E,  -688, -188 },
+    { 0x84C8D4DFD2C63F3B,  -661, -180 }, { 0xC5DD44271AD3CDBA,  -635, -172 }, { 0x936B9FCEBB25C996,  -608, -164 },
+    { 0xDBAC6C247D62A584,  -582, -156 }, { 0xA3AB66580D5FDAF6,  -555, -148 }, { 0xF3E2F893DEC3F126,  -529, -140 },
+    { 0xB5B5ADA8AAFF80B8,  -502, -132 }, { 0x87625F056C7C4A8B,  -475, -124 }, { 0xC9BCFF6034C13053,  -449, -116 },
+    { 0x964E858C91BA2655,  -422, -108 }, { 0xDFF9772470297EBD,  -396, -100 }, { 0xA6DFBD9FB8E5B88F,  -369,  -92 },
+    { 0xF8A95FCF88747D94,  -343,  -84 }, { 0xB94470938FA89BCF,  -316,  -76 }, { 0x8A08F0F8BF0F156B,  -289,  -68 },
+    { 0xCDB02555653131B6,  -263,  -60 }, { 0x993FE2C6D07B7FAC,  -236,  -52 }, { 0xE45C10C42A2B3B06,  -210,  -44 },
+    { 0xAA242499697392D3,  -183,  -36 }, { 0xFD87B5F28300CA0E,  -157,  -28 }, { 0xBCE5086492111AEB,  -130,  -20 },
+    { 0x8CBCCC096F5088CC,  -103,  -12 }, { 0xD1B71758E219652C,   -77,   -4 }, { 0x9C40000000000000,   -50,    4 },
+    { 0xE8D4A51000000000,   -24,   12 }, { 0xAD78EBC5AC620000,     3,   20 }, { 0x813F3978F8940984,    30,   28 },
+    { 0xC097CE7BC90715B3,    56,   36 }, { 0x8F7E32CE7BEA5C70,    83,   44 }, { 0xD5D238A4ABE98068,   109,   52 },
+    { 0x9F4F2726179A2245,   136,   60 }, { 0xED63A231D4C4FB27,   162,   68 }, { 0xB0DE65388CC8ADA8,   189,   76 },
+    { 0x83C7088E1AAB65DB,   216,   84 }, { 0xC45D1DF942711D9A,   242,   92 }, { 0x924D692CA61BE758,   269,  100 },
+    { 0xDA01EE641A708DEA,   295,  108 }, { 0xA26DA3999AEF774A,   322,  116 }, { 0xF209787BB47D6B85,   348,  124 },
+    { 0xB454E4A179DD1877,   375,  132 }, { 0x865B86925B9BC5C2,   402,  140 }, { 0xC83553C5C8965D3D,   428,  148 },
+    { 0x952AB45CFA97A0B3,   455,  156 }, { 0xDE469FBD99A05FE3,   481,  164 }, { 0xA59BC234DB398C25,   508,  172 },
+    { 0xF6C69A72A3989F5C,   534,  180 }, { 0xB7DCBF5354E9BECE,   561,  188 }, { 0x88FCF317F22241E2,   588,  196 },
+    { 0xCC20CE9BD35C78A5,   614,  204 }, { 0x98165AF37B2153DF,   641,  212 }, { 0xE2A0B5DC971F303A,   667,  220 },
+    { 0xA8D9D1535CE3B396,   694,  228 }, { 0xFB9B7CD9A4A7443C,   720,  236 }, { 0xBB764C4CA7A44410,   747,  244 },
+    { 0x8BAB8EEFB6409C1A,   774,  252 }, { 0xD01FEF10A657842C,   800,  260 }, { 0x9B10A4E5E9913129,   827,  268 },
+    { 0xE7109BFBA19C0C9D,   853,  276 }, { 0xAC2820D9623BF429,   880,  284 }, { 0x80444B5E7AA7CF85,   907,  292 },
+    { 0xBF21E44003ACDD2D,   933,  300 }, { 0x8E679C2F5E44FF8F,   960,  308 }, { 0xD433179D9C8CB841,   986,  316 },
+    { 0x9E19DB92B4E31BA9,  1013,  324 }
+  };
+  // choose power c such that -60 <= c.e + e + 64 <= -32, so that product fits in 64 bits w/ 32 bit integer part
+  int f = -60 - e - 1;
+  int kk = (f * 78913) / (1 << 18) + (f > 0);  // ceil(f * log10(2))
+  int idx = (300 + kk + 7) / 8;
+  *k = cachedPowers[idx].k;
+  return {cachedPowers[idx].f, cachedPowers[idx].e};
+}
+
+inline void grisu2_round(char* buf, int len, uint64_t dist, uint64_t delta, uint64_t rest, uint64_t ten_k)
+{
+  // move last digit down while we are still inside the rounding interval and closer to w
+  while(rest < dist && delta - rest >= ten_k && (rest + ten_k < dist || dist - rest > rest + ten_k - dist)) {
+    --buf[len - 1];
+    rest += ten_k;
+  }
+}
+
+// generate digits of M+ (upper boundary), stopping as soon as the result lies within (M-, M+)
+inline int grisu2_digit_gen(char* buf, int* dec_exp, DiyFp mminus, DiyFp w, DiyFp mplus)
+{
+  static const uint32_t pow10s[] = {1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000};
+  uint64_t delta = mplus.f - mminus.f;
+  uint64_t dist = mplus.f - w.f;
+  const int shift = -mplus.e;
+  const uint64_t one = uint64_t(1) << shift;
+  uint32_t p1 = uint32_t(mplus.f >> shift);  // integer part
+  uint64_t p2 = mplus.f & (one - 1);  // fractional part
+  int len = 0;
+  int n = 1;
+  while(n < 10 && p1 >= pow10s[n]) ++n;
+  while(n > 0) {
+    uint32_t pow10 = pow10s[--n];
+    buf[len++] = char('0' + p1 / pow10);
+    p1 %= pow10;
+    uint64_t rest = (uint64_t(p1) << shift) + p2;
+    if(rest <= delta) {
+      *dec_exp += n;
+      grisu2_round(buf, len, dist, delta, rest, uint64_t(pow10) << shift);
+      return len;
+    }
+  }
+  int m = 0;
+  for(;;) {
+    p2 *= 10;
+    buf[len++] = char('0' + (p2 >> shift));
+    p2 &= one - 1;
+    ++m;
+    delta *= 10;
+    dist *= 10;
+    if(p2 <= delta)
+      break;
+  }
+  *dec_exp -= m;
+  grisu2_round(buf, len, dist, delta, p2, one);
+  return len;
+}
+
+// writes shortest digits of finite v > 0 to buf (max 17 chars) and returns number of digits; decimal exponent
+//  is written to dec_exp such that v == digits * 10^dec_exp
+template<typename Real>
+int grisu2(char* buf, int* dec_exp, Real v)
+{
+  constexpr int precision = std::numeric_limits<Real>::digits;  // incl. hidden bit
+  constexpr int bias = std::numeric_limits<Real>::max_exponent - 1 + (precision - 1);
+  constexpr uint64_t hiddenbit = uint64_t(1) << (precision - 1);
+  typedef typename std::conditional<precision == 24, uint32_t, uint64_t>::type Bits;
+  Bits bits;
+  memcpy(&bits, &v, sizeof(Bits));
+  uint64_t E = bits >> (precision - 1);
+  uint64_t F = bits & (hiddenbit - 1);
+  DiyFp w = E == 0 ? DiyFp{F, 1 - bias} : DiyFp{F + hiddenbit, int(E) - bias};
+  // boundaries m- and m+ are halfway to neighboring floats; lower boundary is closer if F == 0
+  DiyFp mplus = DiyFp::normalize({2*w.f + 1, w.e - 1});
+  DiyFp mminus = F == 0 && E > 1 ? DiyFp{4*w.f - 1, w.e - 2} : DiyFp{2*w.f - 1, w.e - 1};
+  mminus = {mminus.f << (mminus.e - mplus.e), mplus.e};
+  w = DiyFp::normalize(w);
+
+  int k;
+  DiyFp c = grisu2_cached_power(mplus.e, &k);
+  DiyFp ww = DiyFp::mul(w, c);
+  DiyFp wminus = DiyFp::mul(mminus, c);
+  DiyFp wplus = DiyFp::mul(mplus, c);
+  // shrink interval by 1 ulp to account for rounding errors in mul()
+  *dec_exp = -k;
+  return grisu2_digit_gen(buf, dec_exp, {wminus.f + 1, wminus.e}, ww, {wplus.f - 1, wplus.e});
+}
+
+// write digits[0..len) as decimal number w/ decimal point after first `point` digits, e.g. "123", -1 -> 0.0123
+inline int digitsToStr(char* str, const char* digits, int len, int point, bool negative)
+{
   int ii = 0;
-  do {
-    str[ii++] = '0' + char(x % 10);
-    x /= 10;
-  } while(x > 0);
   if(negative)
     str[ii++] = '-';
-  std::reverse(str, str+ii);
+  if(point <= 0)
+    str[ii++] = '0';
+  for(int jj = 0; jj < point; ++jj)
+    str[ii++] = jj < len ? digits[jj] : '0';
+  if(len > point) {
+    str[ii++] = '.';
+    for(int jj = point; jj < len; ++jj)
+      str[ii++] = jj < 0 ? '0' : digits[jj];
+  }
   return ii;
 }
 
+// handle NaN, inf, and zero for realToStr; returns 0 if f is none of these
+template<typename Real>
+static int specialRealToStr(char* str, Real f)
+{
+  if(f != f) { memcpy(str, "nan", 3); return 3; }
+  if(f == 0) { str[0] = '0'; return 1; }  // prevent "-0"
+  if(f > std::numeric_limits<Real>::max()) { memcpy(str, "inf", 3); return 3; }
+  if(f < -std::numeric_limits<Real>::max()) { memcpy(str, "-inf", 4); return 4; }
+  return 0;
+}
+
+// printf("%.*f") w/ trailing zeros dropped - only used for short output (< 400 chars)
+inline int realToStrPrintf(char* str, double f, int prec)
+{
+  char tmp[400];
+  int n = snprintf(tmp, sizeof(tmp), "%.*f", prec, f);
+  if(prec > 0) {
+    while(tmp[n - 1] == '0') --n;
+    if(tmp[n - 1] == '.') --n;
+  }
+  if(n == 2 && tmp[0] == '-' && tmp[1] == '0') {
+    str[0] = '0';  // prevent "-0"
+    return 1;
+  }
+  memcpy(str, tmp, n);
+  return n;
+}
+
+// number of binary digits after the point in exact value of finite, nonzero f
+template<typename Real>
+int realFracBits(Real f)
+{
+  int e;
+  uint64_t m = uint64_t(std::ldexp(std::frexp(f < 0 ? -f : f, &e), std::numeric_limits<Real>::digits));
+  e -= std::numeric_limits<Real>::digits;
+  while(!(m & 1)) { m >>= 1; ++e; }
+  return e < 0 ? -e : 0;
+}
+
+// fixed precision conversion covering full range of Real by rounding shortest round-trip digits; these can
+//  round differently than the exact value when they end in a 5 at the cutoff or when the exact value is a
+//  midpoint (i.e. has prec + 1 binary fraction digits), so printf (which rounds exact value, half to even) is
+//  used in those (rare) cases; if more digits are requested than shortest representation has, output will differ
+//  from printf, which prints digits of exact value
+template<typename Real>
+int realToStrFixed(char* str, Real f, int prec)
+{
+  int n = specialRealToStr(str, f);
+  if(n > 0)
+    return n;
+  bool negative = f < 0;
+  char digits[24];
+  int dec_exp;
+  int len = grisu2(digits, &dec_exp, negative ? -f : f);
+  int point = len + dec_exp;
+  int nkeep = point + prec;
+  // nkeep <= len <= 17, so printf output length is < 400 (incl. leading zeros); also use printf if all 17
+  //  digits are kept, since Grisu2 doesn't always choose closest of the 17 digit candidates
+  if(prec >= 0 && nkeep <= len && ((nkeep == len - 1 && digits[nkeep] == '5') || realFracBits(f) == prec + 1
+      || (nkeep == len && len >= std::numeric_limits<Real>::max_digits10)))
+    return realToStrPrintf(str, double(f), prec);
+  if(nkeep < 0)
+    len = 0;
+  else if(nkeep < len) {
+    bool roundup = digits[nkeep] >= '5';
+    len = nkeep;
+    if(roundup) {
+      while(len > 0 && digits[len - 1] == '9') --len;
+      if(len > 0)
+        ++digits[len - 1];
+      else {
+        digits[len++] = '1';  // all nines (or nothing kept): carry to new leading digit
+        ++point;
+      }
+    }
+  }
+  while(len > 0 && digits[len - 1] == '0') --len;
+  if(len == 0) {
+    str[0] = '0';
+    return 1;
+  }
+  return digitsToStr(str, digits, len, point, negative);
+}
+
+// print f with up to prec digits after decimal point, dropping trailing zeros
 template<typename Real>
 int realToStr(char* str, Real f, int prec)
 {
   static const Real powers_of_10[] = {1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000};
 
-  // we could of course extend range and precision we handle by using 64-bit ints
+  // use fast path below for common case
   if(!(f < INT_MAX && f > -INT_MAX && prec < 10))  // handles NaN, since all comparisons with NaN return false
-    return stbsp_sprintf(str, "%.*f", prec, f);  // let the professionals handle this one
+    return realToStrFixed(str, f, prec);
 
   bool negative = f < 0;
   if(negative)
@@ -341,78 +1010,415 @@ int realToStr(char* str, Real f, int prec)
   return ii;
 }
 
-#define UTF8_ACCEPT 0
-#define UTF8_REJECT 12
-unsigned int decode_utf8(unsigned int* state, unsigned int* codep, unsigned char _byte);
+// print shortest string which will be parsed by strtod (or strtof for float) back to the exact value of f
+//  (strToReal is faster but not always exact); exponential notation is used for very large and very small
+//  numbers; max length is 24 chars
+template<typename Real>
+int realToStr(char* str, Real f)
+{
+  int n = specialRealToStr(str, f);
+  if(n > 0)
+    return n;
+  bool negative = f < 0;
+  char digits[24];
+  int dec_exp;
+  int len = grisu2(digits, &dec_exp, negative ? -f : f);
+  int point = len + dec_exp;
+  if(point > -6 && point <= 21)
+    return digitsToStr(str, digits, len, point, negative);
+  // exponential notation: d.ddde[-]xx
+  n = digitsToStr(str, digits, len, 1, negative);
+  str[n++] = 'e';
+  return n + intToStr(str + n, point - 1);
+}
 
-// replacement for C rand()
-void srandpp(unsigned int s);
-unsigned int randpp();
-#define RANDPP_MAX UINT_MAX
-std::string randomStr(const unsigned int len);
+// Type-safe alternative to fstring() w/ format string parsed at compile time; "{}" is replaced by the next
+//  argument, "{:.N}" prints a real w/ up to N digits after the decimal point (realToStr(str, f, N)), "{{" and
+//  "}}" print literal braces; integers use intToStr and reals w/o precision use shortest realToStr(str, f);
+//  pointers (other than char*) print address in hex
+// Format string must be wrapped with FMT(); number of arguments and format syntax are checked at compile time:
+//  std::string s = fstring(FMT("{} of {} at {:.2}%"), n, total, pct);
+//  int len = fmtToBuff(buff, sizeof(buff), FMT("x: {}"), x);  -- no allocation
+//  fmtToStream(memstrm, FMT("<g id='{}'>"), id);  -- any class w/ write(const void*, size_t), e.g. MemStream
+// Requires C++14; fmtArg() overloads (used by StringBuilder <<) are always available
+#ifdef STRINGUTIL_CPP14
+#define FMT(s) [](){ struct FmtStr { static constexpr const char* str() { return s; } }; return FmtStr(); }()
+
+// compile-time format string parsing
+struct FmtParse
+{
+  // position of next '{' or '}' at or after pos (or of terminating '\0')
+  static constexpr size_t nextBrace(const char* s, size_t pos)
+    { while(s[pos] && s[pos] != '{' && s[pos] != '}') { ++pos; } return pos; }
+  // position after closing '}' of placeholder starting at pos, or 0 if invalid
+  static constexpr size_t specEnd(const char* s, size_t pos)
+  {
+    if(s[pos + 1] == '}') return pos + 2;
+    if(s[pos + 1] != ':' || s[pos + 2] != '.' || !isDigitC(s[pos + 3])) return 0;
+    pos += 3;
+    while(isDigitC(s[pos])) ++pos;
+    return s[pos] == '}' ? pos + 1 : 0;
+  }
+  // precision for placeholder at pos, or -1 if none
+  static constexpr int precision(const char* s, size_t pos)
+  {
+    if(s[pos + 1] != ':') return -1;
+    int prec = 0;
+    for(pos += 3; isDigitC(s[pos]); ++pos) prec = 10*prec + (s[pos] - '0');
+    return prec;
+  }
+  enum Kind { END = 0, ESCAPE, PLACEHOLDER, INVALID };
+  static constexpr int kind(const char* s, size_t pos)
+  {
+    return !s[pos] ? END : s[pos] == s[pos + 1] ? ESCAPE
+        : s[pos] == '{' && specEnd(s, pos) > 0 ? PLACEHOLDER : INVALID;
+  }
+  static constexpr bool isDigitC(char c) { return c >= '0' && c <= '9'; }
+};
+#endif // STRINGUTIL_CPP14
 
-#endif  // header section
+template<class W> void fmtArg(W& w, const char* s, int) { w.write(s, strlen(s)); }
+template<class W> void fmtArg(W& w, const std::string& s, int) { w.write(s.data(), s.size()); }
+template<class W> void fmtArg(W& w, const StringRef& s, int) { w.write(s.data(), s.size()); }
+template<class W> void fmtArg(W& w, char c, int) { w.write(&c, 1); }
+template<class W> void fmtArg(W& w, bool b, int) { b ? w.write("true", 4) : w.write("false", 5); }
 
-#ifdef STRINGUTIL_IMPLEMENTATION
-#undef STRINGUTIL_IMPLEMENTATION
+// pointers other than char* print address in hex (rather than converting to bool)
+template<class W> void fmtArg(W& w, const void* p, int)
+{
+  char buff[24];
+  int ii = sizeof(buff);
+  uintptr_t x = uintptr_t(p);
+  do { buff[--ii] = "0123456789abcdef"[x & 0xF]; x >>= 4; } while(x);
+  buff[--ii] = 'x';
+  buff[--ii] = '0';
+  w.write(buff + ii, sizeof(buff) - ii);
+}
 
-#ifndef STRINGUTIL_NO_STB_IMPL
-// unaligned access crashes on 32-bit ARM (Android) and seems like a bad idea anyway
-#define STB_SPRINTF_NOUNALIGNED
-#define STB_SPRINTF_IMPLEMENTATION
-#include "stb_sprintf.h"
-#endif
+template<class W, typename T>
+typename std::enable_if<std::is_integral<T>::value>::type fmtArg(W& w, T x, int)
+{
+  char buff[24];
+  w.write(buff, intToStr(buff, x));
+}
 
-static char* stb_sprintfcb(const char* buf, void* user, int len)
+template<class W, typename T>
+typename std::enable_if<std::is_floating_point<T>::value>::type fmtArg(W& w, T x, int prec)
 {
-  static_cast<std::string*>(user)->append(buf, len);
-  return (char*)buf;  // stb_sprintf always calls this with base of buf passed to it
+  char buff[400];  // fixed precision output for very large or small values can be long
+  w.write(buff, prec < 0 ? realToStr(buff, x) : realToStr(buff, x, prec));
 }
 
-// template<class... Args>  std::string fstring(fmt, Args&&... args) -  fn(fmt, std::forward<Args>(args)...)
-std::string fstring(const char* fmt, ...)
+#ifdef STRINGUTIL_CPP14
+template<class Fmt, size_t Pos, class W, class... Args>
+void fmtRun(W& w, const Args&... args);
+
+template<class Fmt, size_t Pos, class W, class... Args>
+void fmtStep(W&, std::integral_constant<int, FmtParse::END>, const Args&...)
 {
-#ifdef STB_SPRINTF_MIN
-  // standard snprintf always returns number of bytes needed to print entire string, whereas stbsp_snprintf
-  //  only returns this if passed buf = 0 and count = 0 (otherwise returns actual number written), so we
-  //  instead use the callback version, stbsp_vsprintfcb (extra copy, but saves memory)
-  char buf[STB_SPRINTF_MIN];
-  std::string str;
-  va_list va;
-  va_start(va, fmt);
-  stbsp_vsprintfcb(stb_sprintfcb, &str, buf, fmt, va);
-  va_end(va);
-  return str;
-#else
-  char buf[512];
-  buf[0] = '\0';
-  va_list va, va2;
-  va_start(va, fmt);
-  va_copy(va2, va);
-  int n = vsnprintf(buf, 512, fmt, va);
-  std::string str;
-  if(n < 512)
-    str = buf;
-  else {
-    str.resize(n);
-    vsnprintf(&str[0], n+1, fmt, va2);
-  }
-  va_end(va2);
-  va_end(va);
-  return str;
-#endif
+  static_assert(sizeof...(Args) == 0, "Too many arguments for format string");
 }
 
-const char* findWord(const char* str, const char* word, char sep)
+template<class Fmt, size_t Pos, class W, class... Args>
+void fmtStep(W& w, std::integral_constant<int, FmtParse::ESCAPE>, const Args&... args)
 {
-  size_t l = 0;
-  const char* s = str;
-  for(;;) {
-    s = strstr(s, word);
-    if(!s || !word[0])  // prevent infinite loop if empty string passed
-      return NULL;
-    if(!l)
-      l = strlen(word);
+  w.write(Fmt::str() + Pos, 1);
+  fmtRun<Fmt, Pos + 2>(w, args...);
+}
+
+template<class Fmt, size_t Pos, class W, class T, class... Args>
+void fmtStep(W& w, std::integral_constant<int, FmtParse::PLACEHOLDER>, const T& arg, const Args&... args)
+{
+  static_assert(FmtParse::precision(Fmt::str(), Pos) < 0 || std::is_floating_point<T>::value,
+      "Precision {:.N} is only valid for real arguments");
+  fmtArg(w, arg, FmtParse::precision(Fmt::str(), Pos));
+  fmtRun<Fmt, FmtParse::specEnd(Fmt::str(), Pos)>(w, args...);
+}
+
+template<class Fmt, size_t Pos, class W>
+void fmtStep(W&, std::integral_constant<int, FmtParse::PLACEHOLDER>)
+{
+  static_assert(sizeof(W) == 0, "Too few arguments for format string");
+}
+
+template<class Fmt, size_t Pos, class W, class... Args>
+void fmtStep(W&, std::integral_constant<int, FmtParse::INVALID>, const Args&...)
+{
+  static_assert(sizeof(W) == 0, "Invalid format string: unmatched brace or unsupported format spec");
+}
+
+template<class Fmt, size_t Pos, class W, class... Args>
+void fmtRun(W& w, const Args&... args)
+{
+  constexpr size_t next = FmtParse::nextBrace(Fmt::str(), Pos);
+  if(next > Pos)
+    w.write(Fmt::str() + Pos, next - Pos);
+  fmtStep<Fmt, next>(w, std::integral_constant<int, FmtParse::kind(Fmt::str(), next)>(), args...);
+}
+
+// write formatted output to any class w/ write(const void*, size_t) method, e.g. MemStream
+template<class W, class Fmt, class... Args>
+void fmtToStream(W& w, Fmt, const Args&... args) { fmtRun<Fmt, 0>(w, args...); }
+
+// like snprintf: output is truncated to fit in n bytes including '\0' terminator (if n > 0), return value is
+//  length of untruncated output
+struct FmtBuff
+{
+  char* buff;
+  size_t cap;
+  size_t len;
+  size_t write(const void* src, size_t n)
+    { if(len < cap) { memcpy(buff + len, src, std::min(n, cap - len)); } len += n; return n; }
+};
+
+template<class Fmt, class... Args>
+int fmtToBuff(char* buff, size_t n, Fmt fmt, const Args&... args)
+{
+  FmtBuff w = {buff, n > 0 ? n - 1 : 0, 0};
+  fmtToStream(w, fmt, args...);
+  if(n > 0)
+    buff[std::min(w.len, w.cap)] = '\0';
+  return int(w.len);
+}
+
+struct FmtString
+{
+  std::string& str;
+  size_t write(const void* src, size_t n) { str.append((const char*)src, n); return n; }
+};
+
+template<class Fmt, class... Args, class = typename std::enable_if<std::is_class<Fmt>::value>::type>
+std::string fstring(Fmt fmt, const Args&... args)
+{
+  std::string str;
+  FmtString w = {str};
+  fmtToStream(w, fmt, args...);
+  return str;
+}
+#endif // STRINGUTIL_CPP14
+
+// String builder for serialization: numbers are formatted directly w/ intToStr and realToStr (no temporary
+//  std::strings or stringstream); reserve() expected size for a single allocation, otherwise buffer grows
+//  geometrically; release() hands off buffer w/o copying.  Can also be passed to fmtToStream()
+class StringBuilder
+{
+public:
+  StringBuilder(size_t _reserve = 0) { buff.reserve(_reserve); }
+
+  StringBuilder& append(const char* s, size_t n) { buff.append(s, n); return *this; }
+  StringBuilder& append(const StringRef& s) { buff.append(s.data(), s.size()); return *this; }
+  template<typename Real>
+  StringBuilder& appendReal(Real f, int prec) { char tmp[400]; return append(tmp, realToStr(tmp, f, prec)); }
+  // printf-style formatting, appending directly to buffer
+  StringBuilder& appendf(const char* fmt, ...);
+#ifdef STRINGUTIL_CPP14
+  // compile-time checked formatting, e.g. sb.fmt(FMT("{}: {:.2}"), name, val)
+  template<class Fmt, class... Args>
+  StringBuilder& fmt(Fmt f, const Args&... args) { fmtToStream(*this, f, args...); return *this; }
+#endif
+  // integers, reals (shortest round-trip), bool, char, and strings
+  template<typename T>
+  StringBuilder& operator<<(const T& x) { fmtArg(*this, x, -1); return *this; }
+
+  size_t write(const void* src, size_t n) { buff.append((const char*)src, n); return n; }
+  const char* data() const { return buff.data(); }
+  size_t size() const { return buff.size(); }
+  bool empty() const { return buff.empty(); }
+  StringRef ref() const { return StringRef(buff); }
+  void reserve(size_t n) { buff.reserve(n); }
+  void clear() { buff.clear(); }
+  std::string release() { std::string res; res.swap(buff); return res; }
+
+private:
+  std::string buff;
+};
+
+template<typename T>
+std::string joinStrImpl(const std::vector<T>& strs, const char* sep, std::true_type)
+{
+  StringBuilder sb;
+  for(size_t ii = 0; ii < strs.size(); ++ii) {
+    if(ii > 0)
+      sb << sep;
+    sb << StringRef(strs[ii]);
+  }
+  return sb.release();
+}
+
+template<typename T>
+std::string joinStrImpl(const std::vector<T>& strs, const char* sep, std::false_type)
+{
+  std::stringstream ss;
+  if(!strs.empty())
+    ss << strs[0];
+  for(size_t ii = 1; ii < strs.size(); ++ii)
+    ss << sep << strs[ii];
+  return ss.str();
+}
+
+// accept vector of anything that can be written to stringstream; string types skip the stream, but others
+//  still use it so output is unchanged (e.g. 6 digit precision for doubles, int8_t written as char)
+template<typename T>
+std::string joinStr(const std::vector<T>& strs, const char* sep)
+{
+  return joinStrImpl(strs, sep, std::integral_constant<bool, std::is_convertible<const T&, StringRef>::value>());
+}
+
+// optimized specialization for std::string
+template<>
+std::string joinStr(const std::vector<std::string>& strs, const char* sep);
+
+#define UTF8_ACCEPT 0
+#define UTF8_REJECT 12
+unsigned int decode_utf8(unsigned int* state, unsigned int* codep, unsigned char _byte);
+// bulk UTF-8 functions, using SIMD where available
+bool utf8_valid(const char* str, size_t len);
+// number of code points (i.e. non-continuation bytes) in valid UTF-8
+size_t utf8_count(const char* str, size_t len);
+// transcode to UTF-32 or UTF-16; dest must have room for len units; invalid sequences are replaced w/ U+FFFD;
+//  returns number of units written
+size_t utf8_to_utf32(const char* str, size_t len, uint32_t* dest);
+size_t utf8_to_utf16(const char* str, size_t len, uint16_t* dest);
+
+// xoshiro256++ PRNG (Blackman & Vigna) - 32 bytes of state and much faster than std::mt19937
+class Rng
+{
+public:
+  Rng(uint64_t seed = 0) { this->seed(seed); }
+  constexpr Rng(uint64_t s0, uint64_t s1, uint64_t s2, uint64_t s3) : s{s0, s1, s2, s3} {}  // not all zero!
+  void seed(uint64_t seed);  // state is filled w/ splitmix64 as recommended
+  uint64_t next64()
+  {
+    uint64_t res = rotl(s[0] + s[3], 23) + s[0];
+    uint64_t t = s[1] << 17;
+    s[2] ^= s[0];  s[3] ^= s[1];  s[1] ^= s[2];  s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl(s[3], 45);
+    return res;
+  }
+  uint32_t next32() { return uint32_t(next64() >> 32); }  // upper bits are best
+  // unbiased value in [0, n) using Lemire's multiply-shift method ("Fast Random Integer Generation in an
+  //  Interval", 2019) - no division except in rare case of rejection
+  uint32_t bounded(uint32_t n)
+  {
+    uint64_t m = uint64_t(next32())*n;
+    if(uint32_t(m) < n) {
+      uint32_t thresh = (0u - n) % n;
+      while(uint32_t(m) < thresh)
+        m = uint64_t(next32())*n;
+    }
+    return uint32_t(m >> 32);
+  }
+  double uniform() { return (next64() >> 11) * (1.0/9007199254740992.0); }  // [0, 1); 2^-53
+  void fill(void* dest, size_t len);  // random bytes
+  void fill(uint32_t* dest, size_t n, uint32_t bound);  // values in [0, bound)
+  // advance by 2^128 steps - used to generate non-overlapping streams
+  void jump();
+
+private:
+  static uint64_t rotl(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+  uint64_t s[4];
+};
+
+// replacement for C rand() using thread-local Rng: after srandpp(s), calling thread's sequence is fully
+//  determined by s; other threads get independent streams (s jumped by stream index), assigned in order
+//  of first use unless set explicitly w/ srandppStream() (e.g. w/ worker index) for reproducibility
+void srandpp(unsigned int s);
+void srandppStream(unsigned int stream);
+Rng& threadRng();
+inline unsigned int randpp() { return threadRng().next32(); }
+inline unsigned int randpp(unsigned int n) { return threadRng().bounded(n); }  // unbiased value in [0, n)
+#define RANDPP_MAX UINT_MAX
+std::string randomStr(const unsigned int len);
+
+#endif  // header section
+
+#ifdef STRINGUTIL_IMPLEMENTATION
+#undef STRINGUTIL_IMPLEMENTATION
+
+#ifndef STRINGUTIL_NO_STB_IMPL
+// unaligned access crashes on 32-bit ARM (Android) and seems like a bad idea anyway
+#define STB_SPRINTF_NOUNALIGNED
+#define STB_SPRINTF_IMPLEMENTATION
+#include "stb_sprintf.h"
+#endif
+
+// SIMD is selected at compile time, e.g. w/ -march=native; define STRINGUTIL_NO_SIMD to use scalar code only
+#ifndef STRINGUTIL_NO_SIMD
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define STRINGUTIL_AVX2 1
+#elif defined(__SSSE3__)
+#include <tmmintrin.h>
+#define STRINGUTIL_SSSE3 1
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define STRINGUTIL_NEON 1
+#endif
+#endif
+
+static char* stb_sprintfcb(const char* buf, void* user, int len)
+{
+  static_cast<std::string*>(user)->append(buf, len);
+  return (char*)buf;  // stb_sprintf always calls this with base of buf passed to it
+}
+
+// template<class... Args>  std::string fstring(fmt, Args&&... args) -  fn(fmt, std::forward<Args>(args)...)
+// append formatted output to str
+static void vappendf(std::string& str, const char* fmt, va_list va)
+{
+#ifdef STB_SPRINTF_MIN
+  // standard snprintf always returns number of bytes needed to print entire string, whereas stbsp_snprintf
+  //  only returns this if passed buf = 0 and count = 0 (otherwise returns actual number written), so we
+  //  instead use the callback version, stbsp_vsprintfcb (extra copy, but saves memory)
+  char buf[STB_SPRINTF_MIN];
+  stbsp_vsprintfcb(stb_sprintfcb, &str, buf, fmt, va);
+#else
+  char buf[512];
+  buf[0] = '\0';
+  va_list va2;
+  va_copy(va2, va);
+  int n = vsnprintf(buf, 512, fmt, va);
+  if(n < 512)
+    str.append(buf, n);
+  else {
+    size_t pos = str.size();
+    str.resize(pos + n);
+    vsnprintf(&str[pos], n+1, fmt, va2);
+  }
+  va_end(va2);
+#endif
+}
+
+std::string fstring(const char* fmt, ...)
+{
+  std::string str;
+  va_list va;
+  va_start(va, fmt);
+  vappendf(str, fmt, va);
+  va_end(va);
+  return str;
+}
+
+StringBuilder& StringBuilder::appendf(const char* fmt, ...)
+{
+  va_list va;
+  va_start(va, fmt);
+  vappendf(buff, fmt, va);
+  va_end(va);
+  return *this;
+}
+
+const char* findWord(const char* str, const char* word, char sep)
+{
+  size_t l = 0;
+  const char* s = str;
+  for(;;) {
+    s = strstr(s, word);
+    if(!s || !word[0])  // prevent infinite loop if empty string passed
+      return NULL;
+    if(!l)
+      l = strlen(word);
     if((s == str || s[-1] == sep) && (s[l] == '\0' || s[l] == sep))
       return s;
     s += l;  // we found a subword match at s, thus s+l is not past end of string
@@ -449,6 +1455,148 @@ char* strNstr(const char* s, const char* substr, size_t len)
   return NULL;
 }
 
+size_t WordSet::hash(const StringRef& word) { return size_t(wyhash(word)); }
+
+WordSet::WordSet(const StringRef& str, char _sep) : sep(_sep)
+{
+  for(const StringRef& w : splitStringRef(str, sep, true))
+    add(w);
+}
+
+int WordSet::find(const StringRef& word, size_t h) const
+{
+  if(table.empty())
+    return -1;
+  size_t mask = table.size() - 1;
+  for(size_t ii = h & mask; table[ii].idx >= 0; ii = (ii + 1) & mask) {
+    if(table[ii].hash == uint32_t(h) && StringRef(words[table[ii].idx]) == word)
+      return table[ii].idx;
+  }
+  return -1;
+}
+
+void WordSet::insert(int idx, size_t h)
+{
+  size_t mask = table.size() - 1;
+  size_t ii = h & mask;
+  while(table[ii].idx >= 0) ii = (ii + 1) & mask;
+  table[ii] = {uint32_t(h), idx};
+}
+
+void WordSet::rehash(size_t n)
+{
+  table.assign(n, {0, -1});
+  for(size_t jj = 0; jj < words.size(); ++jj)
+    insert(int(jj), hash(words[jj]));
+}
+
+bool WordSet::add(const StringRef& word)
+{
+  size_t h = hash(word);
+  if(word.isEmpty() || find(word, h) >= 0)
+    return false;
+  words.push_back(word.toString());
+  // keep load factor <= 1/2
+  if(2*words.size() > table.size())
+    rehash(std::max(size_t(16), 2*table.size()));
+  else
+    insert(int(words.size() - 1), h);
+  return true;
+}
+
+std::string WordSet::toString() const
+{
+  return joinStr(words, std::string(1, sep).c_str());
+}
+
+// removal should be rare, so just rebuild table
+bool WordSet::remove(const StringRef& word)
+{
+  int idx = find(word, hash(word));
+  if(idx < 0)
+    return false;
+  words.erase(words.begin() + idx);
+  rehash(table.size());
+  return true;
+}
+
+int WordMatcher::add(const StringRef& word)
+{
+  int node = 0;
+  for(char c : word) {
+    int next = -1;
+    for(auto& child : trie[node]) {
+      if(child.first == (unsigned char)c) { next = child.second; break; }
+    }
+    if(next < 0) {
+      next = int(trie.size());
+      trie[node].emplace_back((unsigned char)c, next);
+      trie.emplace_back();
+      trieWord.push_back(-1);
+    }
+    node = next;
+  }
+  int idx = int(wordLens.size());
+  wordLens.push_back(int(word.size()));
+  // for duplicate words, only first is reported; empty words never match
+  if(node > 0 && trieWord[node] < 0)
+    trieWord[node] = idx;
+  built = false;
+  return idx;
+}
+
+void WordMatcher::build() const
+{
+  // compress alphabet to chars actually used
+  memset(charClass, 0, sizeof(charClass));
+  nClasses = 1;
+  for(auto& children : trie) {
+    for(auto& child : children) {
+      if(!charClass[child.first])
+        charClass[child.first] = (unsigned char)nClasses++;
+    }
+  }
+  size_t nnodes = trie.size();
+  delta.assign(nnodes*nClasses, 0);
+  outLink.assign(nnodes, 0);
+  std::vector<int> fail(nnodes, 0);
+  std::vector<int> queue;
+  queue.reserve(nnodes);
+  for(auto& child : trie[0]) {
+    delta[charClass[child.first]] = child.second;
+    queue.push_back(child.second);
+  }
+  // BFS: transitions for missing children are taken from failure node, which is shallower so already done
+  for(size_t qi = 0; qi < queue.size(); ++qi) {
+    int node = queue[qi];
+    int* row = &delta[node*nClasses];
+    memcpy(row, &delta[fail[node]*nClasses], nClasses*sizeof(int));
+    for(auto& child : trie[node]) {
+      int cls = charClass[child.first];
+      int f = delta[fail[node]*nClasses + cls];
+      fail[child.second] = f;
+      outLink[child.second] = trieWord[f] >= 0 ? f : outLink[f];
+      row[cls] = child.second;
+      queue.push_back(child.second);
+    }
+  }
+  built = true;
+}
+
+std::vector<int> WordMatcher::findAll(const StringRef& str, char sep) const
+{
+  std::vector<int> res;
+  find(str, [&](int w, size_t) { res.push_back(w); }, sep);
+  return res;
+}
+
+bool WordMatcher::containsAny(const StringRef& str, char sep) const
+{
+  bool res = false;
+  find(str, [&](int, size_t) { res = true; }, sep);
+  return res;
+}
+
 // don't make this a member of StringRef so that StringRef doesn't require inclusion of std::vector
 std::vector<StringRef> splitStringRef(const StringRef& strRef, char sep, bool skipEmpty)
 {
@@ -482,6 +1630,349 @@ std::vector<StringRef> splitStringRef(const StringRef& strRef, const char* sep,
   return lst;
 }
 
+// atom table: entries are never freed or moved, so readers can use them w/o locking; hash table is replaced
+//  (w/ old copies leaked) when it needs to grow so readers never see a partially rebuilt table
+struct AtomEntry
+{
+  uint64_t hash;
+  int id;
+  size_t len;
+  char str[1];  // allocated w/ room for len chars + '\0'
+};
+
+struct AtomTable
+{
+  size_t mask;
+  std::atomic<AtomEntry*> slots[1];  // allocated w/ mask + 1 slots
+};
+
+static constexpr int ATOM_CHUNK_BITS = 12;
+static constexpr int ATOM_MAX_CHUNKS = 1 << 12;
+static std::mutex atomMutex;
+static std::atomic<AtomTable*> atomTable(NULL);
+static std::atomic<AtomEntry**> atomChunks[ATOM_MAX_CHUNKS];  // id -> entry
+static int atomCount = 0;  // protected by atomMutex
+
+static AtomTable* newAtomTable(size_t n)
+{
+  AtomTable* t = (AtomTable*)calloc(1, sizeof(AtomTable) + (n - 1)*sizeof(std::atomic<AtomEntry*>));
+  t->mask = n - 1;
+  return t;
+}
+
+static AtomEntry* atomProbe(AtomTable* t, const StringRef& str, uint64_t h, size_t* slotOut = NULL)
+{
+  if(!t)
+    return NULL;
+  for(size_t ii = h & t->mask;; ii = (ii + 1) & t->mask) {
+    AtomEntry* e = t->slots[ii].load(std::memory_order_acquire);
+    if(!e || (e->hash == h && e->len == str.size() && memcmp(e->str, str.data(), str.size()) == 0)) {
+      if(slotOut) *slotOut = ii;
+      return e;
+    }
+  }
+}
+
+int findAtom(const StringRef& str)
+{
+  AtomEntry* e = atomProbe(atomTable.load(std::memory_order_acquire), str, wyhash(str));
+  return e ? e->id : 0;
+}
+
+int atomId(const StringRef& str)
+{
+  uint64_t h = wyhash(str);
+  AtomEntry* e = atomProbe(atomTable.load(std::memory_order_acquire), str, h);
+  if(e)
+    return e->id;
+
+  std::lock_guard<std::mutex> lock(atomMutex);
+  AtomTable* t = atomTable.load(std::memory_order_relaxed);
+  size_t slot = 0;
+  e = atomProbe(t, str, h, &slot);  // check again now that we have lock
+  if(e)
+    return e->id;
+  int id = ++atomCount;
+  if(id >= ATOM_MAX_CHUNKS << ATOM_CHUNK_BITS) {
+    --atomCount;
+    return 0;  // too many atoms (~16M)
+  }
+  e = (AtomEntry*)malloc(sizeof(AtomEntry) + str.size());
+  e->hash = h;
+  e->id = id;
+  e->len = str.size();
+  memcpy(e->str, str.data(), str.size());
+  e->str[str.size()] = '\0';
+
+  int chunk = id >> ATOM_CHUNK_BITS;
+  if(!atomChunks[chunk].load(std::memory_order_relaxed))
+    atomChunks[chunk].store((AtomEntry**)calloc(1 << ATOM_CHUNK_BITS, sizeof(AtomEntry*)));
+  atomChunks[chunk].load(std::memory_order_relaxed)[id & ((1 << ATOM_CHUNK_BITS) - 1)] = e;
+
+  // keep load factor <= 1/2
+  if(!t || size_t(2*id) > t->mask + 1) {
+    AtomTable* t2 = newAtomTable(t ? 2*(t->mask + 1) : 1024);
+    for(int ii = 1; ii <= id; ++ii) {
+      AtomEntry* ei = atomChunks[ii >> ATOM_CHUNK_BITS].load(std::memory_order_relaxed)[ii & ((1 << ATOM_CHUNK_BITS) - 1)];
+      size_t jj = ei->hash & t2->mask;
+      while(t2->slots[jj].load(std::memory_order_relaxed)) jj = (jj + 1) & t2->mask;
+      t2->slots[jj].store(ei, std::memory_order_relaxed);
+    }
+    atomTable.store(t2, std::memory_order_release);  // old table leaked, since readers may still be using it
+  }
+  else
+    t->slots[slot].store(e, std::memory_order_release);
+  return id;
+}
+
+StringRef atomStr(int id)
+{
+  AtomEntry** chunk = id > 0 && id < (ATOM_MAX_CHUNKS << ATOM_CHUNK_BITS) ?
+      atomChunks[id >> ATOM_CHUNK_BITS].load(std::memory_order_acquire) : NULL;
+  AtomEntry* e = chunk ? chunk[id & ((1 << ATOM_CHUNK_BITS) - 1)] : NULL;
+  return e ? StringRef(e->str, e->len) : StringRef();
+}
+
+// fastHash long input: XXH3-style - each 64 byte stripe is mixed into 8 x 64-bit accumulators w/ key words
+//  selected by stripe position in 16 stripe block; accumulators are scrambled after each block; last 64 bytes
+//  of input are always processed as final stripe, so stripes consumed must leave at least one byte
+#define FH_STRIPE_LEN 64
+#define FH_BLOCK_STRIPES 16
+
+static const uint64_t fhSecret[24] = {
+  0xba8894fa3be59747ull, 0x069945dea82460daull, 0xf2b5717db02809eaull, 0x4604208f575a097aull,
+  0x9b2af0a33458f9d3ull, 0x0036c74e48fed613ull, 0x250924992b7b8fb9ull, 0x11c2dd5402147e8bull,
+  0xa150217aa00ce50full, 0x1b08078cdca13467ull, 0x0ba8d4827c1ac113ull, 0x10f3ff5b71bb3208ull,
+  0x378ae3c511f071f3ull, 0x2edc5bbc191f9c16ull, 0x8f4870d0d2ffeacaull, 0x0bdfe62b0dad52f6ull,
+  0x81b330eb8eb7f693ull, 0xde7c4e8eb1d4ec36ull, 0x5a3a88dd3d4ce484ull, 0xac4ee57bbf8f82b3ull,
+  0x8aa01872aaa66025ull, 0xf994dede4ff35e16ull, 0xe9e99704acc43221ull, 0xf77540e67c5ce006ull
+};
+
+static const uint64_t fhAccInit[8] = { 0xC2B2AE3Dull, 0x9E3779B185EBCA87ull, 0xC2B2AE3D27D4EB4Full,
+    0x165667B19E3779F9ull, 0x85EBCA77C2B2AE63ull, 0x85EBCA77ull, 0x27D4EB2F165667C5ull, 0x9E3779B1ull };
+
+static const uint32_t FH_PRIME32 = 0x9E3779B1u;
+
+static void fhInit(uint64_t* acc, uint64_t* key, uint64_t seed)
+{
+  memcpy(acc, fhAccInit, sizeof(fhAccInit));
+  for(int ii = 0; ii < 24; ++ii)
+    key[ii] = (ii & 1) ? fhSecret[ii] - seed : fhSecret[ii] + seed;
+}
+
+static inline void fhStripe(uint64_t* acc, const unsigned char* p, const uint64_t* key)
+{
+  for(int ii = 0; ii < 8; ++ii) {
+    uint64_t d, dk;
+    memcpy(&d, p + 8*ii, 8);
+    dk = d ^ key[ii];
+    acc[ii ^ 1] += d;
+    acc[ii] += (dk & 0xFFFFFFFF)*(dk >> 32);
+  }
+}
+
+static inline void fhScramble(uint64_t* acc, const uint64_t* key)
+{
+  for(int ii = 0; ii < 8; ++ii)
+    acc[ii] = (acc[ii] ^ (acc[ii] >> 47) ^ key[ii])*FH_PRIME32;
+}
+
+// consume n stripes from p; *pos is stripe index in current block
+#if defined(STRINGUTIL_AVX2)
+static void fhConsume(uint64_t* acc, const unsigned char* p, size_t n, size_t* pos, const uint64_t* key)
+{
+  __m256i a0 = _mm256_loadu_si256((const __m256i*)acc), a1 = _mm256_loadu_si256((const __m256i*)(acc + 4));
+  const __m256i prime = _mm256_set1_epi64x(FH_PRIME32);
+  size_t jj = *pos;
+  for(size_t ii = 0; ii < n; ++ii, p += FH_STRIPE_LEN) {
+    __m256i d0 = _mm256_loadu_si256((const __m256i*)p), d1 = _mm256_loadu_si256((const __m256i*)(p + 32));
+    __m256i k0 = _mm256_xor_si256(d0, _mm256_loadu_si256((const __m256i*)(key + jj)));
+    __m256i k1 = _mm256_xor_si256(d1, _mm256_loadu_si256((const __m256i*)(key + jj + 4)));
+    a0 = _mm256_add_epi64(a0, _mm256_shuffle_epi32(d0, _MM_SHUFFLE(1, 0, 3, 2)));
+    a1 = _mm256_add_epi64(a1, _mm256_shuffle_epi32(d1, _MM_SHUFFLE(1, 0, 3, 2)));
+    a0 = _mm256_add_epi64(a0, _mm256_mul_epu32(k0, _mm256_srli_epi64(k0, 32)));
+    a1 = _mm256_add_epi64(a1, _mm256_mul_epu32(k1, _mm256_srli_epi64(k1, 32)));
+    if(++jj == FH_BLOCK_STRIPES) {
+      __m256i s0 = _mm256_loadu_si256((const __m256i*)(key + 16)), s1 = _mm256_loadu_si256((const __m256i*)(key + 20));
+      a0 = _mm256_xor_si256(_mm256_xor_si256(a0, _mm256_srli_epi64(a0, 47)), s0);
+      a1 = _mm256_xor_si256(_mm256_xor_si256(a1, _mm256_srli_epi64(a1, 47)), s1);
+      // 64 x 32 bit multiply
+      a0 = _mm256_add_epi64(_mm256_mul_epu32(a0, prime),
+          _mm256_slli_epi64(_mm256_mul_epu32(_mm256_srli_epi64(a0, 32), prime), 32));
+      a1 = _mm256_add_epi64(_mm256_mul_epu32(a1, prime),
+          _mm256_slli_epi64(_mm256_mul_epu32(_mm256_srli_epi64(a1, 32), prime), 32));
+      jj = 0;
+    }
+  }
+  _mm256_storeu_si256((__m256i*)acc, a0);
+  _mm256_storeu_si256((__m256i*)(acc + 4), a1);
+  *pos = jj;
+}
+#elif defined(__SSE2__) && !defined(STRINGUTIL_NO_SIMD)
+#include <emmintrin.h>
+
+static void fhConsume(uint64_t* acc, const unsigned char* p, size_t n, size_t* pos, const uint64_t* key)
+{
+  __m128i a[4];
+  const __m128i prime = _mm_set1_epi64x(FH_PRIME32);
+  for(int kk = 0; kk < 4; ++kk)
+    a[kk] = _mm_loadu_si128((const __m128i*)(acc + 2*kk));
+  size_t jj = *pos;
+  for(size_t ii = 0; ii < n; ++ii, p += FH_STRIPE_LEN) {
+    for(int kk = 0; kk < 4; ++kk) {
+      __m128i d = _mm_loadu_si128((const __m128i*)(p + 16*kk));
+      __m128i dk = _mm_xor_si128(d, _mm_loadu_si128((const __m128i*)(key + jj + 2*kk)));
+      a[kk] = _mm_add_epi64(a[kk], _mm_shuffle_epi32(d, _MM_SHUFFLE(1, 0, 3, 2)));
+      a[kk] = _mm_add_epi64(a[kk], _mm_mul_epu32(dk, _mm_srli_epi64(dk, 32)));
+    }
+    if(++jj == FH_BLOCK_STRIPES) {
+      for(int kk = 0; kk < 4; ++kk) {
+        __m128i s = _mm_loadu_si128((const __m128i*)(key + 16 + 2*kk));
+        __m128i x = _mm_xor_si128(_mm_xor_si128(a[kk], _mm_srli_epi64(a[kk], 47)), s);
+        a[kk] = _mm_add_epi64(_mm_mul_epu32(x, prime), _mm_slli_epi64(_mm_mul_epu32(_mm_srli_epi64(x, 32), prime), 32));
+      }
+      jj = 0;
+    }
+  }
+  for(int kk = 0; kk < 4; ++kk)
+    _mm_storeu_si128((__m128i*)(acc + 2*kk), a[kk]);
+  *pos = jj;
+}
+#else
+static void fhConsume(uint64_t* acc, const unsigned char* p, size_t n, size_t* pos, const uint64_t* key)
+{
+  for(size_t ii = 0; ii < n; ++ii, p += FH_STRIPE_LEN) {
+    fhStripe(acc, p, key + *pos);
+    if(++*pos == FH_BLOCK_STRIPES) {
+      fhScramble(acc, key + 16);
+      *pos = 0;
+    }
+  }
+}
+#endif
+
+static uint64_t fhMerge(const uint64_t* acc, const uint64_t* key, uint64_t h)
+{
+  for(int ii = 0; ii < 4; ++ii)
+    h += wymix(acc[2*ii] ^ key[2*ii], acc[2*ii + 1] ^ key[2*ii + 1]);
+  h ^= h >> 37;
+  h *= 0x165667919E3779F9ull;
+  return h ^ (h >> 32);
+}
+
+// process final stripe (last 64 bytes of input) and merge accumulators; hi is optional
+static void fhFinish(uint64_t* acc, const unsigned char* last, const uint64_t* key, uint64_t len,
+    uint64_t* lo, uint64_t* hi)
+{
+  fhStripe(acc, last, key + 16);
+  *lo = fhMerge(acc, key + 3, len*0x9E3779B185EBCA87ull);
+  if(hi)
+    *hi = fhMerge(acc, key + 13, ~(len*0xC2B2AE3D27D4EB4Full));
+}
+
+// for short inputs, 128-bit hash is pair of wyhash w/ different seeds
+static inline uint64_t fhShortHi(const void* data, size_t len, uint64_t seed)
+{
+  return wyhash(data, len, seed ^ 0xC2B2AE3D27D4EB4Full);
+}
+
+uint64_t fastHash64(const void* data, size_t len, uint64_t seed)
+{
+  if(len <= 256)
+    return wyhash(data, len, seed);
+  const unsigned char* p = (const unsigned char*)data;
+  uint64_t acc[8], key[24], lo;
+  size_t pos = 0;
+  fhInit(acc, key, seed);
+  fhConsume(acc, p, (len - 1)/FH_STRIPE_LEN, &pos, key);
+  fhFinish(acc, p + len - FH_STRIPE_LEN, key, len, &lo, NULL);
+  return lo;
+}
+
+Hash128 fastHash128(const void* data, size_t len, uint64_t seed)
+{
+  if(len <= 256)
+    return Hash128{wyhash(data, len, seed), fhShortHi(data, len, seed)};
+  const unsigned char* p = (const unsigned char*)data;
+  uint64_t acc[8], key[24];
+  size_t pos = 0;
+  Hash128 h;
+  fhInit(acc, key, seed);
+  fhConsume(acc, p, (len - 1)/FH_STRIPE_LEN, &pos, key);
+  fhFinish(acc, p + len - FH_STRIPE_LEN, key, len, &h.lo, &h.hi);
+  return h;
+}
+
+void FastHasher::reset(uint64_t _seed)
+{
+  fhInit(acc, key, _seed);
+  seed = _seed;
+  total = 0;
+  nbuff = 0;
+  nstripes = 0;
+}
+
+// data is only consumed when more follows, so that final stripe is always available
+FastHasher& FastHasher::update(const void* data, size_t len)
+{
+  const unsigned char* p = (const unsigned char*)data;
+  unsigned char* pending = buff + PREV_SIZE;
+  total += len;
+  if(nbuff + len <= BUFF_SIZE) {
+    if(len > 0)
+      memcpy(pending + nbuff, p, len);
+    nbuff += len;
+    return *this;
+  }
+  if(nbuff > 0) {
+    size_t n = BUFF_SIZE - nbuff;
+    memcpy(pending + nbuff, p, n);
+    p += n;
+    len -= n;
+    fhConsume(acc, pending, BUFF_SIZE/FH_STRIPE_LEN, &nstripes, key);
+    memcpy(buff, pending + BUFF_SIZE - FH_STRIPE_LEN, FH_STRIPE_LEN);
+  }
+  // consume directly from input if possible
+  if(len > FH_STRIPE_LEN) {
+    size_t n = (len - 1)/FH_STRIPE_LEN;
+    fhConsume(acc, p, n, &nstripes, key);
+    p += n*FH_STRIPE_LEN;
+    len -= n*FH_STRIPE_LEN;
+    memcpy(buff, p - FH_STRIPE_LEN, FH_STRIPE_LEN);
+  }
+  memcpy(pending, p, len);
+  nbuff = len;
+  return *this;
+}
+
+void FastHasher::finish(uint64_t* lo, uint64_t* hi) const
+{
+  const unsigned char* pending = buff + PREV_SIZE;
+  uint64_t a[8];
+  size_t pos = nstripes;
+  memcpy(a, acc, sizeof(a));
+  fhConsume(a, pending, (nbuff - 1)/FH_STRIPE_LEN, &pos, key);
+  fhFinish(a, pending + nbuff - FH_STRIPE_LEN, key, total, lo, hi);
+}
+
+uint64_t FastHasher::hash64() const
+{
+  if(total <= BUFF_SIZE)
+    return wyhash(buff + PREV_SIZE, nbuff, seed);
+  uint64_t lo;
+  finish(&lo, NULL);
+  return lo;
+}
+
+Hash128 FastHasher::hash128() const
+{
+  if(total <= BUFF_SIZE)
+    return Hash128{wyhash(buff + PREV_SIZE, nbuff, seed), fhShortHi(buff + PREV_SIZE, nbuff, seed)};
+  Hash128 h;
+  finish(&h.lo, &h.hi);
+  return h;
+}
+
 template<>
 std::string joinStr(const std::vector<std::string>& strs, const char* sep)
 {
@@ -537,45 +2028,617 @@ unsigned int decode_utf8(unsigned int* state, unsigned int* codep, unsigned char
   return *state;
 }
 
-// rand() isn't thread-safe either, so don't bother with thread_local for now
-static /* thread_local */ std::mt19937 randGen;
+// Bulk UTF-8 functions: 16-byte blocks are checked w/ SIMD (ASCII fast path, and Keiser & Lemire lookup
+//  algorithm for validation - see simdjson); decode_utf8 handles tails and is the scalar fallback
+#if STRINGUTIL_AVX2 || STRINGUTIL_SSSE3
+#define UTF8_SIMD 1
+typedef __m128i u8x16;
+static inline u8x16 u8x16_load(const unsigned char* p) { return _mm_loadu_si128((const __m128i*)p); }
+static inline u8x16 u8x16_set(unsigned char c) { return _mm_set1_epi8((char)c); }
+static inline u8x16 u8x16_and(u8x16 a, u8x16 b) { return _mm_and_si128(a, b); }
+static inline u8x16 u8x16_or(u8x16 a, u8x16 b) { return _mm_or_si128(a, b); }
+static inline u8x16 u8x16_xor(u8x16 a, u8x16 b) { return _mm_xor_si128(a, b); }
+static inline u8x16 u8x16_subs(u8x16 a, u8x16 b) { return _mm_subs_epu8(a, b); }
+static inline u8x16 u8x16_shr4(u8x16 a) { return _mm_and_si128(_mm_srli_epi16(a, 4), _mm_set1_epi8(0x0F)); }
+static inline u8x16 u8x16_lookup(u8x16 table, u8x16 idx) { return _mm_shuffle_epi8(table, idx); }
+template<int N> static inline u8x16 u8x16_prev(u8x16 a, u8x16 prev) { return _mm_alignr_epi8(a, prev, 16 - N); }
+static inline bool u8x16_any(u8x16 a) { return _mm_movemask_epi8(_mm_cmpeq_epi8(a, _mm_setzero_si128())) != 0xFFFF; }
+static inline bool u8x16_ascii(u8x16 a) { return _mm_movemask_epi8(a) == 0; }
+// number of bytes which are not continuation bytes (i.e., not 10xxxxxx)
+static inline int u8x16_count_lead(u8x16 a)
+{
+  unsigned int m = _mm_movemask_epi8(_mm_cmpgt_epi8(a, _mm_set1_epi8(-65)));
+#ifdef _MSC_VER
+  return __popcnt(m);
+#else
+  return __builtin_popcount(m);
+#endif
+}
 
-void srandpp(unsigned int s) { randGen.seed(s); }
-// technically, rand()%N is slightly biased, but it's fine for our purposes; std::uniform_int_distribution
-//  is implementation dependent, which defeats the whole reason I'm replacing rand()
-unsigned int randpp() { return randGen(); }  // or >> 1?
+static inline void utf8_widen16(const unsigned char* p, uint16_t* out)
+{
+  __m128i v = u8x16_load(p), z = _mm_setzero_si128();
+  _mm_storeu_si128((__m128i*)out, _mm_unpacklo_epi8(v, z));
+  _mm_storeu_si128((__m128i*)(out + 8), _mm_unpackhi_epi8(v, z));
+}
+
+static inline void utf8_widen16(const unsigned char* p, uint32_t* out)
+{
+  __m128i v = u8x16_load(p), z = _mm_setzero_si128();
+  __m128i lo = _mm_unpacklo_epi8(v, z), hi = _mm_unpackhi_epi8(v, z);
+  _mm_storeu_si128((__m128i*)out, _mm_unpacklo_epi16(lo, z));
+  _mm_storeu_si128((__m128i*)(out + 4), _mm_unpackhi_epi16(lo, z));
+  _mm_storeu_si128((__m128i*)(out + 8), _mm_unpacklo_epi16(hi, z));
+  _mm_storeu_si128((__m128i*)(out + 12), _mm_unpackhi_epi16(hi, z));
+}
+#elif STRINGUTIL_NEON
+#define UTF8_SIMD 1
+typedef uint8x16_t u8x16;
+static inline u8x16 u8x16_load(const unsigned char* p) { return vld1q_u8(p); }
+static inline u8x16 u8x16_set(unsigned char c) { return vdupq_n_u8(c); }
+static inline u8x16 u8x16_and(u8x16 a, u8x16 b) { return vandq_u8(a, b); }
+static inline u8x16 u8x16_or(u8x16 a, u8x16 b) { return vorrq_u8(a, b); }
+static inline u8x16 u8x16_xor(u8x16 a, u8x16 b) { return veorq_u8(a, b); }
+static inline u8x16 u8x16_subs(u8x16 a, u8x16 b) { return vqsubq_u8(a, b); }
+static inline u8x16 u8x16_shr4(u8x16 a) { return vshrq_n_u8(a, 4); }
+static inline u8x16 u8x16_lookup(u8x16 table, u8x16 idx) { return vqtbl1q_u8(table, idx); }
+template<int N> static inline u8x16 u8x16_prev(u8x16 a, u8x16 prev) { return vextq_u8(prev, a, 16 - N); }
+static inline bool u8x16_any(u8x16 a) { return vmaxvq_u8(a) != 0; }
+static inline bool u8x16_ascii(u8x16 a) { return vmaxvq_u8(a) < 0x80; }
+static inline int u8x16_count_lead(u8x16 a)
+{
+  return vaddvq_u8(vandq_u8(vcgtq_s8(vreinterpretq_s8_u8(a), vdupq_n_s8(-65)), vdupq_n_u8(1)));
+}
+
+static inline void utf8_widen16(const unsigned char* p, uint16_t* out)
+{
+  uint8x16_t v = vld1q_u8(p);
+  vst1q_u16(out, vmovl_u8(vget_low_u8(v)));
+  vst1q_u16(out + 8, vmovl_high_u8(v));
+}
+
+static inline void utf8_widen16(const unsigned char* p, uint32_t* out)
+{
+  uint8x16_t v = vld1q_u8(p);
+  uint16x8_t lo = vmovl_u8(vget_low_u8(v)), hi = vmovl_high_u8(v);
+  vst1q_u32(out, vmovl_u16(vget_low_u16(lo)));
+  vst1q_u32(out + 4, vmovl_high_u16(lo));
+  vst1q_u32(out + 8, vmovl_u16(vget_low_u16(hi)));
+  vst1q_u32(out + 12, vmovl_high_u16(hi));
+}
+#endif
+
+#ifdef UTF8_SIMD
+static inline u8x16 u8x16_table(const unsigned char* t) { return u8x16_load(t); }
+
+// returns nonzero bytes for any errors in block `in`, given previous block `prev`
+static inline u8x16 utf8_check_block(u8x16 in, u8x16 prev)
+{
+  // error classes for pairs of bytes (prev1, in); an error is present if bit is set in all three lookups
+  enum : unsigned char { TOO_SHORT = 1<<0,  // 11______ 0_______ or 11______ 11______
+      TOO_LONG = 1<<1,  // 0_______ 10______
+      OVERLONG_3 = 1<<2,  // 11100000 100_____
+      TOO_LARGE = 1<<3,  // 11110100 1001____, 11110100 101_____, 11110101+ 10______
+      SURROGATE = 1<<4,  // 11101101 101_____
+      OVERLONG_2 = 1<<5,  // 1100000_ 10______
+      TOO_LARGE_1000 = 1<<6,  // 11110101+ 1000____
+      OVERLONG_4 = 1<<6,  // 11110000 1000____
+      TWO_CONTS = 1<<7,  // 10______ 10______ (valid only if 3rd or 4th byte of sequence)
+      CARRY = TOO_SHORT | TOO_LONG | TWO_CONTS };
+  static const unsigned char byte1high[16] = { TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG,
+      TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TWO_CONTS, TWO_CONTS, TWO_CONTS, TWO_CONTS,
+      TOO_SHORT | OVERLONG_2, TOO_SHORT, TOO_SHORT | OVERLONG_3 | SURROGATE,
+      TOO_SHORT | TOO_LARGE | TOO_LARGE_1000 | OVERLONG_4 };
+  static const unsigned char byte1low[16] = { CARRY | OVERLONG_3 | OVERLONG_2 | OVERLONG_4,
+      CARRY | OVERLONG_2, CARRY, CARRY, CARRY | TOO_LARGE, CARRY | TOO_LARGE | TOO_LARGE_1000,
+      CARRY | TOO_LARGE | TOO_LARGE_1000, CARRY | TOO_LARGE | TOO_LARGE_1000,
+      CARRY | TOO_LARGE | TOO_LARGE_1000, CARRY | TOO_LARGE | TOO_LARGE_1000,
+      CARRY | TOO_LARGE | TOO_LARGE_1000, CARRY | TOO_LARGE | TOO_LARGE_1000,
+      CARRY | TOO_LARGE | TOO_LARGE_1000, CARRY | TOO_LARGE | TOO_LARGE_1000 | SURROGATE,
+      CARRY | TOO_LARGE | TOO_LARGE_1000, CARRY | TOO_LARGE | TOO_LARGE_1000 };
+  static const unsigned char byte2high[16] = { TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+      TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+      TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE_1000 | OVERLONG_4,
+      TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE,
+      TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+      TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+      TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT };
+
+  u8x16 prev1 = u8x16_prev<1>(in, prev);
+  u8x16 sc = u8x16_and(u8x16_and(u8x16_lookup(u8x16_table(byte1high), u8x16_shr4(prev1)),
+      u8x16_lookup(u8x16_table(byte1low), u8x16_and(prev1, u8x16_set(0x0F)))),
+      u8x16_lookup(u8x16_table(byte2high), u8x16_shr4(in)));
+  // TWO_CONTS is expected where byte is 3rd or 4th of a sequence
+  u8x16 is3rd = u8x16_subs(u8x16_prev<2>(in, prev), u8x16_set(0xE0 - 0x80));  // >= 0x80 iff prev2 >= 0xE0
+  u8x16 is4th = u8x16_subs(u8x16_prev<3>(in, prev), u8x16_set(0xF0 - 0x80));
+  u8x16 must23 = u8x16_and(u8x16_or(is3rd, is4th), u8x16_set(0x80));
+  return u8x16_xor(must23, sc);
+}
+
+// nonzero if block ends w/ an incomplete sequence
+static inline u8x16 utf8_incomplete(u8x16 in)
+{
+  static const unsigned char maxval[16] =
+      { 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 0xF0 - 1, 0xE0 - 1, 0xC0 - 1 };
+  return u8x16_subs(in, u8x16_table(maxval));
+}
+#endif
+
+bool utf8_valid(const char* str, size_t len)
+{
+  const unsigned char* p = (const unsigned char*)str;
+  const unsigned char* end = p + len;
+#ifdef UTF8_SIMD
+  if(len >= 16) {
+    u8x16 prev = u8x16_set(0), err = u8x16_set(0), incomplete = u8x16_set(0);
+    for(; end - p >= 16; p += 16) {
+      u8x16 in = u8x16_load(p);
+      if(u8x16_ascii(in))
+        err = u8x16_or(err, incomplete);
+      else {
+        err = u8x16_or(err, utf8_check_block(in, prev));
+        incomplete = utf8_incomplete(in);
+      }
+      prev = in;
+    }
+    if(u8x16_any(err))
+      return false;
+    // back up to start of last sequence, which may be incomplete, and finish w/ DFA
+    const unsigned char* q = p;
+    while(q > (const unsigned char*)str && p - q < 3 && (q[-1] & 0xC0) == 0x80) --q;
+    if(q > (const unsigned char*)str && q[-1] >= 0xC0) --q;
+    p = q;
+  }
+#endif
+  unsigned int state = UTF8_ACCEPT, codep = 0;
+  while(p < end) {
+    if(state == UTF8_ACCEPT && end - p >= 8) {
+      uint64_t w;
+      memcpy(&w, p, 8);
+      if(!(w & 0x8080808080808080ull)) {  // skip 8 ASCII bytes
+        p += 8;
+        continue;
+      }
+    }
+    if(decode_utf8(&state, &codep, *p++) == UTF8_REJECT)
+      return false;
+  }
+  return state == UTF8_ACCEPT;
+}
+
+size_t utf8_count(const char* str, size_t len)
+{
+  const unsigned char* p = (const unsigned char*)str;
+  const unsigned char* end = p + len;
+  size_t n = 0;
+#ifdef UTF8_SIMD
+  for(; end - p >= 16; p += 16)
+    n += u8x16_count_lead(u8x16_load(p));
+#endif
+  for(; p < end; ++p)
+    n += (*p & 0xC0) != 0x80;
+  return n;
+}
+
+static inline void utf8_put(uint32_t*& out, unsigned int c) { *out++ = c; }
+
+static inline void utf8_put(uint16_t*& out, unsigned int c)
+{
+  if(c > 0xFFFF) {
+    *out++ = uint16_t(0xD800 + ((c - 0x10000) >> 10));
+    *out++ = uint16_t(0xDC00 + (c & 0x3FF));
+  }
+  else
+    *out++ = uint16_t(c);
+}
+
+template<typename T>
+static size_t utf8_transcode(const char* str, size_t len, T* dest)
+{
+  const unsigned char* p = (const unsigned char*)str;
+  const unsigned char* end = p + len;
+  T* out = dest;
+  while(p < end) {
+    unsigned int c = *p;
+    if(c < 0x80) {
+#ifdef UTF8_SIMD
+      while(end - p >= 16 && u8x16_ascii(u8x16_load(p))) {
+        utf8_widen16(p, out);
+        p += 16;
+        out += 16;
+      }
+#endif
+      // copy up to 16 ASCII bytes before trying SIMD again
+      for(const unsigned char* q = std::min(p + 16, end); p < q && *p < 0x80;)
+        *out++ = *p++;
+      continue;
+    }
+    // fast path for valid sequences
+    size_t n = end - p;
+    if(c >= 0xC2 && c < 0xE0 && n >= 2 && (p[1] & 0xC0) == 0x80) {
+      utf8_put(out, ((c & 0x1F) << 6) | (p[1] & 0x3F));
+      p += 2;
+      continue;
+    }
+    if(c >= 0xE0 && c < 0xF0 && n >= 3 && (p[1] & 0xC0) == 0x80 && (p[2] & 0xC0) == 0x80) {
+      c = ((c & 0x0F) << 12) | ((p[1] & 0x3F) << 6) | (p[2] & 0x3F);
+      if(c >= 0x800 && (c < 0xD800 || c > 0xDFFF)) {
+        utf8_put(out, c);
+        p += 3;
+        continue;
+      }
+    }
+    else if(c >= 0xF0 && c < 0xF5 && n >= 4 && (p[1] & 0xC0) == 0x80 && (p[2] & 0xC0) == 0x80
+        && (p[3] & 0xC0) == 0x80) {
+      c = ((c & 0x07) << 18) | ((p[1] & 0x3F) << 12) | ((p[2] & 0x3F) << 6) | (p[3] & 0x3F);
+      if(c >= 0x10000 && c < 0x110000) {
+        utf8_put(out, c);
+        p += 4;
+        continue;
+      }
+    }
+    // invalid or truncated sequence: use DFA to find end of invalid prefix and replace it w/ U+FFFD; byte
+    //  causing rejection could start a new sequence, so it is reprocessed unless it is the first byte
+    unsigned int state = UTF8_ACCEPT, codep = 0;
+    const unsigned char* q = p;
+    while(q < end && decode_utf8(&state, &codep, *q) != UTF8_REJECT) ++q;
+    utf8_put(out, 0xFFFD);
+    p = q == p ? p + 1 : q;
+  }
+  return out - dest;
+}
+
+size_t utf8_to_utf32(const char* str, size_t len, uint32_t* dest) { return utf8_transcode(str, len, dest); }
+size_t utf8_to_utf16(const char* str, size_t len, uint16_t* dest) { return utf8_transcode(str, len, dest); }
+
+void Rng::seed(uint64_t seed)
+{
+  for(uint64_t& x : s) {
+    uint64_t z = (seed += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    x = z ^ (z >> 31);
+  }
+}
+
+void Rng::jump()
+{
+  static const uint64_t JUMP[] =
+      { 0x180ec6d33cfd0aba, 0xd5a61266f0c9392c, 0xa9582618e03fc9aa, 0x39abdc4529b1661c };
+  uint64_t t[4] = {0, 0, 0, 0};
+  for(uint64_t j : JUMP) {
+    for(int b = 0; b < 64; ++b) {
+      if(j & (uint64_t(1) << b)) {
+        for(int ii = 0; ii < 4; ++ii)
+          t[ii] ^= s[ii];
+      }
+      next64();
+    }
+  }
+  memcpy(s, t, sizeof(s));
+}
+
+void Rng::fill(void* dest, size_t len)
+{
+  unsigned char* p = (unsigned char*)dest;
+  for(; len >= 8; len -= 8, p += 8) {
+    uint64_t x = next64();
+    memcpy(p, &x, 8);
+  }
+  if(len > 0) {
+    uint64_t x = next64();
+    memcpy(p, &x, len);
+  }
+}
+
+void Rng::fill(uint32_t* dest, size_t n, uint32_t bound)
+{
+  for(size_t ii = 0; ii < n; ++ii)
+    dest[ii] = bounded(bound);
+}
+
+// srandpp() bumps epoch; threads reseed on next use if their epoch is stale
+static std::atomic<unsigned int> randSeed(0);
+static std::atomic<unsigned int> randEpoch(1);
+static std::atomic<unsigned int> randNextStream(1);
+
+struct ThreadRng
+{
+  Rng rng;
+  unsigned int epoch;
+  // constant initialization avoids overhead of thread_local init check on every access
+  constexpr ThreadRng() : rng(0, 0, 0, 0), epoch(0) {}
+  void reseed(unsigned int stream)
+  {
+    epoch = randEpoch;
+    rng.seed(randSeed);
+    for(unsigned int ii = 0; ii < stream; ++ii)
+      rng.jump();
+  }
+};
+
+static thread_local ThreadRng threadRngState;
+
+Rng& threadRng()
+{
+  if(threadRngState.epoch != randEpoch.load(std::memory_order_relaxed))
+    threadRngState.reseed(randNextStream++);
+  return threadRngState.rng;
+}
+
+void srandpp(unsigned int s)
+{
+  randSeed = s;
+  randNextStream = 1;
+  ++randEpoch;
+  threadRngState.epoch = randEpoch;
+  threadRngState.rng.seed(s);  // calling thread gets stream 0
+}
+
+void srandppStream(unsigned int stream)
+{
+  threadRngState.reseed(stream);
+}
 
 // generate a random string
 std::string randomStr(const unsigned int len)
 {
   static const char alphanum[] = "0123456789" "ABCDEFGHIJKLMNOPQRSTUVWXYZ" "abcdefghijklmnopqrstuvwxyz";
 
+  Rng& rng = threadRng();
   std::string s(len, 'x');
   for(unsigned int ii = 0; ii < len; ++ii)
-    s[ii] = alphanum[randpp() % (sizeof(alphanum) - 1)];
+    s[ii] = alphanum[rng.bounded(sizeof(alphanum) - 1)];
   return s;
 }
 
 // base64 encode/decode:
-// based on https://github.com/gaspardpetit/base64/blob/master/src/ManuelMartinez/ManuelMartinez.h
+// scalar code originally based on https://github.com/gaspardpetit/base64/blob/master/src/ManuelMartinez/ManuelMartinez.h
 // modified to skip whitespace (and other invalid chars) when decoding
+// SIMD code based on Wojciech Mula's work: http://0x80.pl/notesen/2016-01-12-sse-base64-encoding.html and
+//  http://0x80.pl/notesen/2016-01-17-sse-base64-decoding.html ; decoding uses SIMD for runs of valid chars and
+//  falls back to scalar code to skip invalid chars
 static const char base64enc[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
 
+// const table (instead of lazily initialized) so that decoding is thread-safe
+static const signed char base64dec[256] = {
+  -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,  -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+  -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,62,-1,-1,-1,63,  52,53,54,55,56,57,58,59,60,61,-1,-1,-1,-1,-1,-1,
+  -1, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9,10,11,12,13,14,  15,16,17,18,19,20,21,22,23,24,25,-1,-1,-1,-1,-1,
+  -1,26,27,28,29,30,31,32,33,34,35,36,37,38,39,40,  41,42,43,44,45,46,47,48,49,50,51,-1,-1,-1,-1,-1,
+  -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,  -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+  -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,  -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+  -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,  -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+  -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,  -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+};
+
+// Each SIMD impl provides base64_encode_block: encode B64_ENC_IN bytes to 4*B64_ENC_IN/3 chars, reading up to
+//  B64_ENC_READ bytes, and base64_decode_block: decode B64_DEC_IN chars to 3*B64_DEC_IN/4 bytes, writing up to
+//  B64_DEC_WRITE bytes and returning B64_DEC_IN on success or index of first invalid char otherwise
+#if STRINGUTIL_AVX2
+#define B64_ENC_IN 24
+#define B64_ENC_READ 28
+#define B64_DEC_IN 32
+#define B64_DEC_WRITE 32
+
+static inline void base64_encode_block(const unsigned char* src, char* dest)
+{
+  // 12 input bytes in each 128-bit lane
+  __m128i lo = _mm_loadu_si128((const __m128i*)src);
+  __m128i hi = _mm_loadu_si128((const __m128i*)(src + 12));
+  __m256i in = _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+  // split each 3 bytes into 4 x 6-bit values, one per byte
+  in = _mm256_shuffle_epi8(in, _mm256_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10,
+      1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10));
+  __m256i t0 = _mm256_mulhi_epu16(_mm256_and_si256(in, _mm256_set1_epi32(0x0FC0FC00)), _mm256_set1_epi32(0x04000040));
+  __m256i t1 = _mm256_mullo_epi16(_mm256_and_si256(in, _mm256_set1_epi32(0x003F03F0)), _mm256_set1_epi32(0x01000010));
+  __m256i idx = _mm256_or_si256(t0, t1);
+  // map 6-bit values to ASCII by adding offset selected based on range
+  __m256i res = _mm256_subs_epu8(idx, _mm256_set1_epi8(51));
+  __m256i less = _mm256_cmpgt_epi8(_mm256_set1_epi8(26), idx);
+  res = _mm256_or_si256(res, _mm256_and_si256(less, _mm256_set1_epi8(13)));
+  const __m256i shiftLUT = _mm256_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+      '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0,
+      'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+      '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+  res = _mm256_add_epi8(_mm256_shuffle_epi8(shiftLUT, res), idx);
+  _mm256_storeu_si256((__m256i*)dest, res);
+}
+
+static inline __m256i b64_in_range(__m256i x, char lo, char hi)
+{
+  return _mm256_and_si256(_mm256_cmpgt_epi8(x, _mm256_set1_epi8(lo - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8(hi + 1), x));
+}
+
+static inline size_t base64_decode_block(const unsigned char* src, unsigned char* dest)
+{
+  __m256i in = _mm256_loadu_si256((const __m256i*)src);
+  // chars >= 0x80 are negative, so fail all range checks
+  __m256i isAZ = b64_in_range(in, 'A', 'Z');
+  __m256i isaz = b64_in_range(in, 'a', 'z');
+  __m256i is09 = b64_in_range(in, '0', '9');
+  __m256i isplus = _mm256_cmpeq_epi8(in, _mm256_set1_epi8('+'));
+  __m256i isslash = _mm256_cmpeq_epi8(in, _mm256_set1_epi8('/'));
+  __m256i valid = _mm256_or_si256(_mm256_or_si256(_mm256_or_si256(isAZ, isaz), _mm256_or_si256(is09, isplus)), isslash);
+  unsigned int mask = ~(unsigned int)_mm256_movemask_epi8(valid);
+  if(mask) {
+#ifdef _MSC_VER
+    unsigned long nz;
+    _BitScanForward(&nz, mask);
+    return nz;
+#else
+    return __builtin_ctz(mask);
+#endif
+  }
+  __m256i shift = _mm256_or_si256(_mm256_and_si256(isAZ, _mm256_set1_epi8(-'A')),
+      _mm256_and_si256(isaz, _mm256_set1_epi8(26 - 'a')));
+  shift = _mm256_or_si256(shift, _mm256_and_si256(is09, _mm256_set1_epi8(52 - '0')));
+  shift = _mm256_or_si256(shift, _mm256_and_si256(isplus, _mm256_set1_epi8(62 - '+')));
+  shift = _mm256_or_si256(shift, _mm256_and_si256(isslash, _mm256_set1_epi8(63 - '/')));
+  __m256i vals = _mm256_add_epi8(in, shift);
+  // pack 4 x 6-bit values into 3 bytes
+  __m256i merged = _mm256_maddubs_epi16(vals, _mm256_set1_epi32(0x01400140));
+  merged = _mm256_madd_epi16(merged, _mm256_set1_epi32(0x00011000));
+  merged = _mm256_shuffle_epi8(merged, _mm256_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+      2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+  merged = _mm256_permutevar8x32_epi32(merged, _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7));
+  _mm256_storeu_si256((__m256i*)dest, merged);
+  return B64_DEC_IN;
+}
+#elif STRINGUTIL_SSSE3
+#define B64_ENC_IN 12
+#define B64_ENC_READ 16
+#define B64_DEC_IN 16
+#define B64_DEC_WRITE 16
+
+static inline void base64_encode_block(const unsigned char* src, char* dest)
+{
+  __m128i in = _mm_loadu_si128((const __m128i*)src);
+  in = _mm_shuffle_epi8(in, _mm_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10));
+  __m128i t0 = _mm_mulhi_epu16(_mm_and_si128(in, _mm_set1_epi32(0x0FC0FC00)), _mm_set1_epi32(0x04000040));
+  __m128i t1 = _mm_mullo_epi16(_mm_and_si128(in, _mm_set1_epi32(0x003F03F0)), _mm_set1_epi32(0x01000010));
+  __m128i idx = _mm_or_si128(t0, t1);
+  __m128i res = _mm_subs_epu8(idx, _mm_set1_epi8(51));
+  __m128i less = _mm_cmpgt_epi8(_mm_set1_epi8(26), idx);
+  res = _mm_or_si128(res, _mm_and_si128(less, _mm_set1_epi8(13)));
+  const __m128i shiftLUT = _mm_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+      '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+  res = _mm_add_epi8(_mm_shuffle_epi8(shiftLUT, res), idx);
+  _mm_storeu_si128((__m128i*)dest, res);
+}
+
+static inline __m128i b64_in_range(__m128i x, char lo, char hi)
+{
+  return _mm_and_si128(_mm_cmpgt_epi8(x, _mm_set1_epi8(lo - 1)), _mm_cmpgt_epi8(_mm_set1_epi8(hi + 1), x));
+}
+
+static inline size_t base64_decode_block(const unsigned char* src, unsigned char* dest)
+{
+  __m128i in = _mm_loadu_si128((const __m128i*)src);
+  __m128i isAZ = b64_in_range(in, 'A', 'Z');
+  __m128i isaz = b64_in_range(in, 'a', 'z');
+  __m128i is09 = b64_in_range(in, '0', '9');
+  __m128i isplus = _mm_cmpeq_epi8(in, _mm_set1_epi8('+'));
+  __m128i isslash = _mm_cmpeq_epi8(in, _mm_set1_epi8('/'));
+  __m128i valid = _mm_or_si128(_mm_or_si128(_mm_or_si128(isAZ, isaz), _mm_or_si128(is09, isplus)), isslash);
+  unsigned int mask = ~(unsigned int)_mm_movemask_epi8(valid) & 0xFFFF;
+  if(mask) {
+#ifdef _MSC_VER
+    unsigned long nz;
+    _BitScanForward(&nz, mask);
+    return nz;
+#else
+    return __builtin_ctz(mask);
+#endif
+  }
+  __m128i shift = _mm_or_si128(_mm_and_si128(isAZ, _mm_set1_epi8(-'A')), _mm_and_si128(isaz, _mm_set1_epi8(26 - 'a')));
+  shift = _mm_or_si128(shift, _mm_and_si128(is09, _mm_set1_epi8(52 - '0')));
+  shift = _mm_or_si128(shift, _mm_and_si128(isplus, _mm_set1_epi8(62 - '+')));
+  shift = _mm_or_si128(shift, _mm_and_si128(isslash, _mm_set1_epi8(63 - '/')));
+  __m128i vals = _mm_add_epi8(in, shift);
+  __m128i merged = _mm_maddubs_epi16(vals, _mm_set1_epi32(0x01400140));
+  merged = _mm_madd_epi16(merged, _mm_set1_epi32(0x00011000));
+  merged = _mm_shuffle_epi8(merged, _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+  _mm_storeu_si128((__m128i*)dest, merged);
+  return B64_DEC_IN;
+}
+#elif STRINGUTIL_NEON
+#define B64_ENC_IN 48
+#define B64_ENC_READ 48
+#define B64_DEC_IN 64
+#define B64_DEC_WRITE 48
+
+static inline void base64_encode_block(const unsigned char* src, char* dest)
+{
+  const uint8x16x4_t lut = vld1q_u8_x4((const uint8_t*)base64enc);
+  uint8x16x3_t in = vld3q_u8(src);  // deinterleave
+  uint8x16x4_t idx;
+  idx.val[0] = vshrq_n_u8(in.val[0], 2);
+  idx.val[1] = vorrq_u8(vshlq_n_u8(vandq_u8(in.val[0], vdupq_n_u8(0x03)), 4), vshrq_n_u8(in.val[1], 4));
+  idx.val[2] = vorrq_u8(vshlq_n_u8(vandq_u8(in.val[1], vdupq_n_u8(0x0F)), 2), vshrq_n_u8(in.val[2], 6));
+  idx.val[3] = vandq_u8(in.val[2], vdupq_n_u8(0x3F));
+  uint8x16x4_t res;
+  for(int ii = 0; ii < 4; ++ii)
+    res.val[ii] = vqtbl4q_u8(lut, idx.val[ii]);
+  vst4q_u8((uint8_t*)dest, res);
+}
+
+static inline uint8x16_t b64_decode_neon(uint8x16_t c, uint8x16_t* valid)
+{
+  // unsigned compare of (c - lo) <= (hi - lo) checks lo <= c <= hi
+  uint8x16_t isAZ = vcleq_u8(vsubq_u8(c, vdupq_n_u8('A')), vdupq_n_u8(25));
+  uint8x16_t isaz = vcleq_u8(vsubq_u8(c, vdupq_n_u8('a')), vdupq_n_u8(25));
+  uint8x16_t is09 = vcleq_u8(vsubq_u8(c, vdupq_n_u8('0')), vdupq_n_u8(9));
+  uint8x16_t isplus = vceqq_u8(c, vdupq_n_u8('+'));
+  uint8x16_t isslash = vceqq_u8(c, vdupq_n_u8('/'));
+  *valid = vandq_u8(*valid, vorrq_u8(vorrq_u8(vorrq_u8(isAZ, isaz), vorrq_u8(is09, isplus)), isslash));
+  uint8x16_t shift = vorrq_u8(vandq_u8(isAZ, vdupq_n_u8(uint8_t(-'A'))), vandq_u8(isaz, vdupq_n_u8(uint8_t(26 - 'a'))));
+  shift = vorrq_u8(shift, vandq_u8(is09, vdupq_n_u8(uint8_t(52 - '0'))));
+  shift = vorrq_u8(shift, vandq_u8(isplus, vdupq_n_u8(uint8_t(62 - '+'))));
+  shift = vorrq_u8(shift, vandq_u8(isslash, vdupq_n_u8(uint8_t(63 - '/'))));
+  return vaddq_u8(c, shift);
+}
+
+static inline size_t base64_decode_block(const unsigned char* src, unsigned char* dest)
+{
+  uint8x16x4_t in = vld4q_u8(src);
+  uint8x16_t valid = vdupq_n_u8(0xFF);
+  uint8x16_t d0 = b64_decode_neon(in.val[0], &valid);
+  uint8x16_t d1 = b64_decode_neon(in.val[1], &valid);
+  uint8x16_t d2 = b64_decode_neon(in.val[2], &valid);
+  uint8x16_t d3 = b64_decode_neon(in.val[3], &valid);
+  if(vminvq_u8(valid) == 0) {
+    // find first invalid char; since data is deinterleaved, it is simplest to just use scalar table
+    size_t ii = 0;
+    while(base64dec[src[ii]] >= 0) ++ii;
+    return ii;
+  }
+  uint8x16x3_t res;
+  res.val[0] = vorrq_u8(vshlq_n_u8(d0, 2), vshrq_n_u8(d1, 4));
+  res.val[1] = vorrq_u8(vshlq_n_u8(d1, 4), vshrq_n_u8(d2, 2));
+  res.val[2] = vorrq_u8(vshlq_n_u8(d2, 6), d3);
+  vst3q_u8(dest, res);
+  return B64_DEC_IN;
+}
+#endif
+
+// encode complete 3 byte groups from [*src, end), advancing *src; returns end of output
+static char* base64_encode_groups(const unsigned char** src, const unsigned char* end, char* out)
+{
+  const unsigned char* p = *src;
+#ifdef B64_ENC_IN
+  for(; end - p >= B64_ENC_READ; p += B64_ENC_IN, out += 4*B64_ENC_IN/3)
+    base64_encode_block(p, out);
+#endif
+  for(; end - p >= 3; p += 3) {
+    unsigned int val = (p[0] << 16) | (p[1] << 8) | p[2];
+    *out++ = base64enc[val >> 18];
+    *out++ = base64enc[(val >> 12) & 0x3F];
+    *out++ = base64enc[(val >> 6) & 0x3F];
+    *out++ = base64enc[val & 0x3F];
+  }
+  *src = p;
+  return out;
+}
+
+// encode final 1 or 2 bytes w/ padding
+static char* base64_encode_tail(const unsigned char* p, size_t n, char* out)
+{
+  if(n > 0) {
+    unsigned int val = (p[0] << 16) | (n > 1 ? p[1] << 8 : 0);
+    *out++ = base64enc[val >> 18];
+    *out++ = base64enc[(val >> 12) & 0x3F];
+    *out++ = n > 1 ? base64enc[(val >> 6) & 0x3F] : '=';
+    *out++ = '=';
+  }
+  return out;
+}
+
 char* base64_encode(const unsigned char* data, size_t len, char* dest)
 {
-  char* out = dest;
-  unsigned int val = 0;
-  int valb = -6;
-  for (const unsigned char *cptr = data; cptr < data + len; ++cptr) {
-    val = (val << 8) + *cptr;  // we could do val & 0x00FFFFFF to shut up ubsan - would be optimized out
-    valb += 8;
-    while (valb >= 0) {
-      *out++ = base64enc[(val >> valb) & 0x3F];
-      valb -= 6;
-    }
-  }
-  if (valb > -6) *out++ = base64enc[((val << 8) >> (valb + 8)) & 0x3F];
-  while ((out - dest) % 4) *out++ = '=';
+  const unsigned char* p = data;
+  char* out = base64_encode_groups(&p, data + len, dest);
+  base64_encode_tail(p, data + len - p, out);
   //ASSERT(out - dest == enclen);
   return dest;
 }
@@ -587,18 +2650,35 @@ std::string base64_encode(const unsigned char* data, size_t len)
   return outstr;
 }
 
-std::vector<unsigned char> base64_decode(const char* data, size_t len)
+// decode [p, end) to out, skipping invalid chars; val and valb hold partial group state; returns end of output
+static unsigned char* base64_decode_chunk(const unsigned char* p, const unsigned char* end,
+    unsigned char* out, unsigned char* outend, unsigned int& val, int& valb)
 {
-  static std::vector<int> base64dec(256, -1);
-  if(base64dec['A'] == -1) { for (int ii = 0; ii < 64; ++ii) base64dec[base64enc[ii]] = ii; }
-
-  std::vector<unsigned char> strout(((len + 2)/4)*3, '\0');
-  unsigned char* out = &strout[0];
-  unsigned int val = 0;
-  int valb = -8;
-  for (size_t ii = 0; ii < len; ++ii) {
-    char c = data[ii];
-    int d = base64dec[c];
+#ifdef B64_DEC_IN
+  size_t nscalar = 0;  // number of chars to process w/ scalar code before trying SIMD again
+#else
+  (void)outend;
+#endif
+  for(; p < end; ++p) {
+#ifdef B64_DEC_IN
+    // SIMD only for blocks starting on a 4 char boundary
+    if(nscalar > 0)
+      --nscalar;
+    else if(valb == -8) {
+      while(end - p >= B64_DEC_IN && outend - out >= B64_DEC_WRITE) {
+        size_t n = base64_decode_block(p, out);
+        if(n < B64_DEC_IN) {
+          nscalar = n;  // process up to and including first invalid char w/ scalar code
+          break;
+        }
+        p += B64_DEC_IN;
+        out += 3*B64_DEC_IN/4;
+      }
+      if(p >= end)
+        break;
+    }
+#endif
+    int d = base64dec[*p];
     if (d == -1) continue;  // skip invalid chars
     val = (val << 6) + (unsigned int)d;
     valb += 6;
@@ -607,11 +2687,53 @@ std::vector<unsigned char> base64_decode(const char* data, size_t len)
       valb -= 8;
     }
   }
+  return out;
+}
+
+std::vector<unsigned char> base64_decode(const char* data, size_t len)
+{
+  std::vector<unsigned char> strout(((len + 2)/4)*3, '\0');
+  unsigned int val = 0;
+  int valb = -8;
+  const unsigned char* p = (const unsigned char*)data;
+  unsigned char* out = base64_decode_chunk(p, p + len, strout.data(), strout.data() + strout.size(), val, valb);
   //ASSERT(out - &strout[0] <= strout.size());
-  strout.resize(out - &strout[0]);
+  strout.resize(out - strout.data());
   return strout;
 }
 
+size_t Base64Encoder::encode(const unsigned char* data, size_t len, char* dest)
+{
+  const unsigned char* end = data + len;
+  char* out = dest;
+  if(npending > 0) {
+    while(npending < 3 && data < end)
+      pending[npending++] = *data++;
+    if(npending < 3)
+      return 0;
+    const unsigned char* p = pending;
+    out = base64_encode_groups(&p, pending + 3, out);
+    npending = 0;
+  }
+  out = base64_encode_groups(&data, end, out);
+  while(data < end)
+    pending[npending++] = *data++;
+  return out - dest;
+}
+
+size_t Base64Encoder::finish(char* dest)
+{
+  size_t n = base64_encode_tail(pending, npending, dest) - dest;
+  npending = 0;
+  return n;
+}
+
+size_t Base64Decoder::decode(const char* data, size_t len, unsigned char* dest)
+{
+  const unsigned char* p = (const unsigned char*)data;
+  return base64_decode_chunk(p, p + len, dest, dest + maxDecodedLen(len), val, valb) - dest;
+}
+
 // sprintf uses bignum library for printing large floats - I don't believe there is any way to get the same
 //  result more simply.  However, for numbers |x| < 2^53 (for version using fmod), realToStr seems to
 //  match sprintf except for cases involving 0.499.... vs. 0.5
@@ -643,6 +2765,53 @@ int main(int argc, char* argv[])
       PLATFORM_LOG("Mismatch for %.32f: sprintf = %s, dimToStr = %s\n", f, s1, s2);
     }
   }
+
+  // shortest round-trip conversion - random bit patterns cover full range of double and float
+  PLATFORM_LOG("Running shortest realToStr round-trip test\n");
+  std::mt19937_64 rng(time(NULL));
+  for(int ii = 0; ii < 10000000; ++ii) {
+    uint64_t bits = rng();
+    double f;
+    memcpy(&f, &bits, sizeof(f));
+    int len2 = realToStr(s2, f);
+    s2[len2] = '\0';
+    if(f == f && strtod(s2, NULL) != f)
+      PLATFORM_LOG("Round-trip failed for %.17g: realToStr = %s\n", f, s2);
+    float g;
+    uint32_t gbits = uint32_t(bits);
+    memcpy(&g, &gbits, sizeof(g));
+    len2 = realToStr(s2, g);
+    s2[len2] = '\0';
+    if(g == g && strtof(s2, NULL) != g)
+      PLATFORM_LOG("Round-trip failed for %.9g: realToStr = %s\n", g, s2);
+  }
+  // ties in shortest digits are rounded from exact value, as by printf
+  for(double f : {1E10 + 0.125, 1E10 + 0.375, -1E10 - 0.625, 3E9 + 0.15, 0.15, 2.5E-300}) {
+    for(int prec : {0, 1, 2, 10, 301}) {
+      sprintf(s1, "%.*f", prec, f);
+      int len1 = strlen(s1);
+      if(prec > 0) {
+        while(s1[len1 - 1] == '0') s1[--len1] = '\0';
+        if(s1[len1 - 1] == '.') s1[--len1] = '\0';
+      }
+      int len2 = realToStrFixed(s2, f, prec);
+      s2[len2] = '\0';
+      if(strcmp(s1, s2) != 0 && strcmp(s1, "-0") != 0)
+        PLATFORM_LOG("Fixed mismatch for %.17g (prec %d): sprintf = %s, realToStr = %s\n", f, prec, s1, s2);
+    }
+  }
+  // fixed precision for values outside fast path range
+  struct { double f; const char* s; } fixedTests[] = {
+    {-1.5E20, "-150000000000000000000"}, {123456789012.125, "123456789012.125"}, {0.5E-9, "0.000000001"},
+    {0.4E-9, "0"}, {9.9999999999E11, "999999999990"}, {-0.99999999995E-3, "-0.001"}
+  };
+  for(auto& t : fixedTests) {
+    int len2 = realToStr(s2, t.f, 9);
+    s2[len2] = '\0';
+    ASSERT(strcmp(s2, t.s) == 0);
+  }
+  // more digits than shortest representation: zero padded, unlike printf, which prints exact binary value
+  ASSERT(std::string(s2, realToStr(s2, 1E300, 9)) == "1" + std::string(300, '0'));
   PLATFORM_LOG("realToStr test completed");
 }
 #elif defined(STRINGUTIL_PERF_REALTOSTR)
@@ -654,11 +2823,29 @@ int main(int argc, char* argv[])
   for(double f = -10000.0; f < 10000.0; f += 0.0001) {
     realToStr(s1, f, 3);
   }
-  PLATFORM_LOG("realToStr: %d ms", mSecSinceEpoch() - t0);
+  PLATFORM_LOG("realToStr: %d ms\n", mSecSinceEpoch() - t0);
+
+  t0 = mSecSinceEpoch();
+  for(double f = -10000.0; f < 10000.0; f += 0.0001) {
+    realToStr(s1, f);
+  }
+  PLATFORM_LOG("realToStr shortest: %d ms\n", mSecSinceEpoch() - t0);
+
+  t0 = mSecSinceEpoch();
+  for(double f = -10000.0; f < 10000.0; f += 0.0001) {
+    stbsp_sprintf(s1, "%.17g", f);
+  }
+  PLATFORM_LOG("sprintf %%.17g: %d ms\n", mSecSinceEpoch() - t0);
+
+  t0 = mSecSinceEpoch();
+  for(double f = 1E10; f < 1E10 + 20000.0; f += 0.0001) {
+    realToStr(s1, f, 3);
+  }
+  PLATFORM_LOG("realToStr large values: %d ms\n", mSecSinceEpoch() - t0);
 }
 #endif
 
-// g++ -x c++ -I../stb -DSTRINGUTIL_TEST_BASE64 -DSTRINGUTIL_IMPLEMENTATION -o base64test stringutil.h
+// g++ -x c++ -O2 -march=native -I../stb -DSTRINGUTIL_TEST_BASE64 -DSTRINGUTIL_IMPLEMENTATION -o base64test stringutil.h
 #ifdef STRINGUTIL_TEST_BASE64
 
 #define PLATFORMUTIL_IMPLEMENTATION
@@ -672,29 +2859,830 @@ std::string randomData(size_t len)
   return s;
 }
 
+static std::string decodeStr(const std::string& s)
+{
+  std::vector<unsigned char> dec = base64_decode(s);
+  return std::string(dec.begin(), dec.end());
+}
+
+// original bit accumulator encoder as reference
+static std::string base64_encode_ref(const std::string& s)
+{
+  std::string out;
+  unsigned int val = 0;
+  int valb = -6;
+  for(unsigned char c : s) {
+    val = (val << 8) + c;
+    valb += 8;
+    while(valb >= 0) {
+      out.push_back(base64enc[(val >> valb) & 0x3F]);
+      valb -= 6;
+    }
+  }
+  if(valb > -6) out.push_back(base64enc[((val << 8) >> (valb + 8)) & 0x3F]);
+  while(out.size() % 4) out.push_back('=');
+  return out;
+}
+
 int main(int argc, char* argv[])
 {
   srandpp(89);
 
-  ASSERT(base64_decode("YW55IHNpbXBsZSBwbGVhcw==") == "any simple pleas");
-  ASSERT(base64_decode("YW55IHNpbXBsZSBwbGVhc3U=") == "any simple pleasu");
-  ASSERT(base64_decode("YW55IHNpbXBsZSBwbGVhc3Vy") == "any simple pleasur");
+  ASSERT(decodeStr("YW55IHNpbXBsZSBwbGVhcw==") == "any simple pleas");
+  ASSERT(decodeStr("YW55IHNpbXBsZSBwbGVhc3U=") == "any simple pleasu");
+  ASSERT(decodeStr("YW55IHNpbXBsZSBwbGVhc3Vy") == "any simple pleasur");
 
-  ASSERT(base64_decode("YW55IHNpbXBsZSBwbGVhcw") == "any simple pleas");
-  ASSERT(base64_decode("YW55IHNpbXBsZSBwbGVhc3U") == "any simple pleasu");
-  ASSERT(base64_decode("YW55IHNpbXBsZSBwbGVhc3Vy") == "any simple pleasur");
+  ASSERT(decodeStr("YW55IHNpbXBsZSBwbGVhcw") == "any simple pleas");
+  ASSERT(decodeStr("YW55IHNpbXBsZSBwbGVhc3U") == "any simple pleasu");
+  ASSERT(decodeStr("YW55IHNpbXBsZSBwbGVhc3Vy") == "any simple pleasur");
 
   for(int n = 10; n < 1000; ++n) {
     std::string s = randomData(n);
     std::string senc = base64_encode(s);
-    ASSERT(base64_decode(senc) == s);
+    ASSERT(senc == base64_encode_ref(s));
+    ASSERT(decodeStr(senc) == s);
     senc.insert(randpp()%n, randpp()%6, ' ');
     senc.insert(senc.size() - randpp()%6, randpp()%6, ' ');
     senc.insert(randpp()%6, randpp()%6, ' ');
     //PLATFORM_LOG(senc.c_str());
     //PLATFORM_LOG("<end>\n\n");
-    ASSERT(base64_decode(senc) == s);
+    ASSERT(decodeStr(senc) == s);
+    // invalid chars (incl. non-ASCII) at random positions
+    for(int ii = 0; ii < 8; ++ii)
+      senc.insert(randpp()%senc.size(), 1, "\n\t\r*-\x80\xFF"[ii]);
+    ASSERT(decodeStr(senc) == s);
+  }
+
+  // incremental encoding and decoding in random sized chunks
+  for(int n = 0; n < 2000; n += 7) {
+    std::string s = randomData(n);
+    std::string senc;
+    Base64Encoder enc;
+    char buff[Base64Encoder::maxEncodedLen(64 + 2)];
+    for(size_t pos = 0; pos < s.size();) {
+      size_t len = std::min(size_t(randpp()%64), s.size() - pos);
+      senc.append(buff, enc.encode((const unsigned char*)s.data() + pos, len, buff));
+      pos += len;
+    }
+    senc.append(buff, enc.finish(buff));
+    ASSERT(senc == base64_encode(s));
+    senc.insert(randpp()%(senc.size() + 1), 1, '\n');
+    std::string sdec;
+    Base64Decoder dec;
+    unsigned char dbuff[Base64Decoder::maxDecodedLen(64)];
+    for(size_t pos = 0; pos < senc.size();) {
+      size_t len = std::min(size_t(randpp()%64), senc.size() - pos);
+      sdec.append((char*)dbuff, dec.decode(senc.data() + pos, len, dbuff));
+      pos += len;
+    }
+    ASSERT(sdec == s);
+  }
+
+  // line breaks every 76 chars (MIME)
+  std::string s = randomData(100000);
+  std::string senc = base64_encode(s);
+  for(size_t pos = 76; pos < senc.size(); pos += 78)
+    senc.insert(pos, "\r\n");
+  ASSERT(decodeStr(senc) == s);
+
+  // throughput - compile w/ and w/o -march=native (or -DSTRINGUTIL_NO_SIMD) to compare; note that decode
+  //  time includes allocation of output vector
+  const size_t N = 32 << 20;
+  const int reps = 10;
+  s = randomData(N);
+  senc.resize(base64_enclen(N));
+  Timestamp t0 = mSecSinceEpoch();
+  for(int ii = 0; ii < reps; ++ii)
+    base64_encode((const unsigned char*)s.data(), N, &senc[0]);
+  Timestamp t1 = mSecSinceEpoch();
+  std::vector<unsigned char> dec;
+  for(int ii = 0; ii < reps; ++ii)
+    dec = base64_decode(senc);
+  Timestamp t2 = mSecSinceEpoch();
+  ASSERT(std::string(dec.begin(), dec.end()) == s);
+  std::string wrapped;
+  for(size_t pos = 0; pos < senc.size(); pos += 76)
+    wrapped.append(senc, pos, 76).append("\n");
+  senc.swap(wrapped);
+  Timestamp t3 = mSecSinceEpoch();
+  for(int ii = 0; ii < reps; ++ii)
+    dec = base64_decode(senc);
+  Timestamp t4 = mSecSinceEpoch();
+  ASSERT(std::string(dec.begin(), dec.end()) == s);
+  double mb = double(reps*N)/(1 << 20);
+  PLATFORM_LOG("base64 encode: %.0f MB/s\n", mb*1000/std::max(Timestamp(1), t1 - t0));
+  PLATFORM_LOG("base64 decode: %.0f MB/s\n", mb*1000/std::max(Timestamp(1), t2 - t1));
+  PLATFORM_LOG("base64 decode w/ line breaks: %.0f MB/s\n", mb*1000/std::max(Timestamp(1), t4 - t3));
+  return 0;
+}
+
+#endif
+
+// g++ -x c++ -O2 -march=native -I../stb -DSTRINGUTIL_TEST_UTF8 -DSTRINGUTIL_IMPLEMENTATION -o utf8test stringutil.h
+#ifdef STRINGUTIL_TEST_UTF8
+
+#define PLATFORMUTIL_IMPLEMENTATION
+#include "platformutil.h"
+
+static void appendUtf8(std::string& s, unsigned int c)
+{
+  if(c < 0x80) s += char(c);
+  else if(c < 0x800) { s += char(0xC0 | (c >> 6)); s += char(0x80 | (c & 0x3F)); }
+  else if(c < 0x10000) { s += char(0xE0 | (c >> 12)); s += char(0x80 | ((c >> 6) & 0x3F)); s += char(0x80 | (c & 0x3F)); }
+  else { s += char(0xF0 | (c >> 18)); s += char(0x80 | ((c >> 12) & 0x3F));
+    s += char(0x80 | ((c >> 6) & 0x3F)); s += char(0x80 | (c & 0x3F)); }
+}
+
+// words of ASCII, 2, 3, or 4 byte chars separated by spaces
+static std::string randomUtf8(size_t nchars)
+{
+  std::string s;
+  while(nchars) {
+    unsigned int r = randpp() % 100;
+    unsigned int base = r < 70 ? 0x21 : r < 80 ? 0x80 : r < 95 ? 0x800 : 0x10000;
+    unsigned int range = r < 70 ? 0x5E : r < 80 ? 0x780 : r < 95 ? 0xF800 : 0x100000;
+    for(size_t wordlen = 1 + randpp() % 8; nchars && wordlen; --nchars, --wordlen) {
+      unsigned int c = base + randpp() % range;
+      appendUtf8(s, c >= 0xD800 && c < 0xE000 ? c - 0x800 : c);
+    }
+    if(nchars) { s += ' '; --nchars; }
+  }
+  return s;
+}
+
+static bool refValid(const std::string& s)
+{
+  unsigned int state = UTF8_ACCEPT, codep = 0;
+  for(unsigned char c : s) {
+    if(decode_utf8(&state, &codep, c) == UTF8_REJECT)
+      return false;
+  }
+  return state == UTF8_ACCEPT;
+}
+
+int main(int argc, char* argv[])
+{
+  // edge cases
+  const char* invalid[] = {"\x80", "\xC0\x80", "\xC1\xBF", "\xE0\x80\x80", "\xED\xA0\x80", "\xF0\x80\x80\x80",
+      "\xF4\x90\x80\x80", "\xF5\x80\x80\x80", "\xFF", "\xE2\x82", "\xF0\x9F\x98", "\xC2\xC2", "a\xC2"};
+  const char* valid[] = {"\xC2\x80", "\xDF\xBF", "\xE0\xA0\x80", "\xED\x9F\xBF", "\xEE\x80\x80",
+      "\xF0\x90\x80\x80", "\xF4\x8F\xBF\xBF", "\xEF\xBB\xBF"};
+  std::string pad(15, 'x');
+  for(const char* s : invalid) {
+    // test at all alignments relative to 16 byte blocks
+    for(size_t ii = 0; ii < 40; ++ii) {
+      std::string t = std::string(ii, 'x') + s + std::string(ii%3 ? 20 : 0, 'y');
+      ASSERT(!utf8_valid(t.data(), t.size()));
+    }
+  }
+  for(const char* s : valid) {
+    for(size_t ii = 0; ii < 40; ++ii) {
+      std::string t = std::string(ii, 'x') + s + pad.substr(0, ii%16);
+      ASSERT(utf8_valid(t.data(), t.size()));
+    }
+  }
+
+  // random strings, w/ and w/o corruption
+  std::vector<uint32_t> u32;
+  std::vector<uint16_t> u16;
+  for(int ii = 0; ii < 200000; ++ii) {
+    std::string s = randomUtf8(randpp() % 100);
+    size_t nchars = utf8_count(s.data(), s.size());
+    ASSERT(utf8_valid(s.data(), s.size()));
+    if(ii % 2 && !s.empty()) {
+      int ncorrupt = 1 + randpp() % 3;
+      while(ncorrupt--)
+        s[randpp() % s.size()] = char(randpp() % 2 ? 0x80 + randpp() % 0x80 : randpp());
+      if(randpp() % 4 == 0) s.resize(randpp() % s.size());
+    }
+    ASSERT(utf8_valid(s.data(), s.size()) == refValid(s));
+    u32.resize(s.size());
+    u16.resize(s.size());
+    size_t n32 = utf8_to_utf32(s.data(), s.size(), u32.data());
+    size_t n16 = utf8_to_utf16(s.data(), s.size(), u16.data());
+    // re-encode and compare
+    std::string s32, s16;
+    for(size_t jj = 0; jj < n32; ++jj) appendUtf8(s32, u32[jj]);
+    for(size_t jj = 0; jj < n16; ++jj) {
+      unsigned int c = u16[jj];
+      if(c >= 0xD800 && c < 0xDC00) { c = 0x10000 + ((c - 0xD800) << 10) + (u16[++jj] - 0xDC00); }
+      appendUtf8(s16, c);
+    }
+    ASSERT(s32 == s16);
+    if(ii % 2 == 0) {
+      ASSERT(n32 == nchars && s32 == s);
+    }
+  }
+  PLATFORM_LOG("UTF-8 tests passed\n");
+
+  std::string ascii(size_t(1) << 24, 'a');
+  std::string mixed = randomUtf8(size_t(1) << 23);
+  u32.resize(std::max(ascii.size(), mixed.size()));
+  // call through volatile pointers to prevent calls from being hoisted out of loops
+  bool (*volatile refValidFn)(const std::string&) = refValid;
+  bool (*volatile validFn)(const char*, size_t) = utf8_valid;
+  size_t (*volatile countFn)(const char*, size_t) = utf8_count;
+  size_t (*volatile utf32Fn)(const char*, size_t, uint32_t*) = utf8_to_utf32;
+  for(const std::string* s : {&ascii, &mixed}) {
+    const int reps = 20;
+    size_t tot = 0;
+    Timestamp t0 = mSecSinceEpoch();
+    for(int ii = 0; ii < reps; ++ii)
+      tot += refValidFn(*s);
+    Timestamp t1 = mSecSinceEpoch();
+    for(int ii = 0; ii < reps; ++ii)
+      tot += validFn(s->data(), s->size());
+    Timestamp t2 = mSecSinceEpoch();
+    for(int ii = 0; ii < reps; ++ii)
+      tot += countFn(s->data(), s->size());
+    Timestamp t3 = mSecSinceEpoch();
+    for(int ii = 0; ii < reps; ++ii)
+      tot += utf32Fn(s->data(), s->size(), u32.data());
+    Timestamp t4 = mSecSinceEpoch();
+    double mb = double(reps*s->size())/(1 << 20);
+    PLATFORM_LOG("%s: decode_utf8 loop %.0f MB/s; utf8_valid %.0f MB/s; utf8_count %.0f MB/s;"
+        " utf8_to_utf32 %.0f MB/s (%d)\n", s == &ascii ? "ASCII" : "mixed", mb*1000/std::max(Timestamp(1), t1 - t0),
+        mb*1000/std::max(Timestamp(1), t2 - t1), mb*1000/std::max(Timestamp(1), t3 - t2),
+        mb*1000/std::max(Timestamp(1), t4 - t3), int(tot));
+  }
+  return 0;
+}
+
+#endif
+
+// g++ -x c++ -O2 -I../stb -DSTRINGUTIL_TEST_INT -DSTRINGUTIL_IMPLEMENTATION -o inttest stringutil.h
+#ifdef STRINGUTIL_TEST_INT
+
+#define PLATFORMUTIL_IMPLEMENTATION
+#include "platformutil.h"
+
+// previous implementation for comparison
+template<typename Int>
+int intToStrRef(char* str, Int x)
+{
+  bool negative = x < 0;
+  if(negative)
+    x = -x;
+  int ii = 0;
+  do {
+    str[ii++] = '0' + char(x % 10);
+    x /= 10;
+  } while(x > 0);
+  if(negative)
+    str[ii++] = '-';
+  std::reverse(str, str+ii);
+  return ii;
+}
+
+// random values w/ uniformly distributed number of digits
+static int64_t randInt64()
+{
+  uint64_t x = (uint64_t(randpp()) << 32) | randpp();
+  x >>= randpp() % 64;
+  return randpp() % 2 ? -int64_t(x >> 1) : int64_t(x >> 1);
+}
+
+template<typename Int>
+static void testInt(Int x)
+{
+  char s1[32], s2[32];
+  int n1 = snprintf(s1, sizeof(s1), std::is_signed<Int>::value ? "%lld" : "%llu", (long long)x);
+  int n2 = intToStr(s2, x);
+  ASSERT(n1 == n2 && memcmp(s1, s2, n1) == 0);
+  Int y = 0;
+  ASSERT(parseInt(s2, s2 + n2, y) == s2 + n2 && y == x);
+}
+
+int main(int argc, char* argv[])
+{
+  testInt(INT32_MIN);  testInt(INT32_MAX);  testInt(INT64_MIN);  testInt(INT64_MAX);  testInt(UINT64_MAX);
+  testInt(int8_t(-128));  testInt(uint16_t(65535));  testInt(0);  testInt(0u);
+  for(int ii = 0; ii < 10000000; ++ii) {
+    int64_t x = randInt64();
+    testInt(x);
+    testInt(int32_t(x));
+    testInt(uint64_t(x));
+  }
+
+  const char* bad[] = {"", "-", "+", "x1", " 1", "-1u"};
+  for(const char* s : bad) {
+    unsigned int u = 7;
+    ASSERT(parseInt(s, s + strlen(s), u) == s && u == 7);
+  }
+  const char* overflow[] = {"2147483648", "-2147483649", "99999999999999999999", "18446744073709551616",
+      "100000000000000000000000"};
+  for(const char* s : overflow) {
+    int32_t x = 7;
+    int64_t y = 7;
+    ASSERT(parseInt(s, s + strlen(s), x) == s && x == 7);
+    ASSERT(strlen(s) < 12 || (parseInt(s, s + strlen(s), y) == s && y == 7));
+  }
+  // stops at first non-digit, leading zeros allowed
+  const char* s = "00000000000000000000012345,678";
+  int x = 0;
+  ASSERT(parseInt(s, s + strlen(s), x) == s + 26 && x == 12345);
+  PLATFORM_LOG("Integer tests passed\n");
+
+  // benchmark
+  const int N = 1 << 20;
+  std::vector<int64_t> vals(N);
+  for(int64_t& v : vals) v = randInt64();
+  std::string buff(N*24, '\0');
+  const int reps = 20;
+  size_t tot = 0;
+  char* out = &buff[0];
+  Timestamp t0 = mSecSinceEpoch();
+  for(int r = 0; r < reps; ++r) {
+    char* p = out;
+    for(int64_t v : vals) { p += intToStrRef(p, v); *p++ = ' '; }
+    tot += p - out;
+  }
+  Timestamp t1 = mSecSinceEpoch();
+  for(int r = 0; r < reps; ++r) {
+    char* p = out;
+    for(int64_t v : vals) { p += intToStr(p, v); *p++ = ' '; }
+    tot += p - out;
+  }
+  Timestamp t2 = mSecSinceEpoch();
+  for(int r = 0; r < reps; ++r) {
+    char* p = out;
+    for(int64_t v : vals) { p += stbsp_sprintf(p, "%lld", (long long)v); *p++ = ' '; }
+    tot += p - out;
+  }
+  Timestamp t3 = mSecSinceEpoch();
+  const char* end = out + (tot/(3*reps));
+  for(int r = 0; r < reps; ++r) {
+    char* p = out;
+    while(p < end) { tot += strtoll(p, &p, 10); ++p; }
+  }
+  Timestamp t4 = mSecSinceEpoch();
+  for(int r = 0; r < reps; ++r) {
+    const char* p = out;
+    int64_t v;
+    while(p < end) { p = parseInt(p, end, v) + 1; tot += v; }
+  }
+  Timestamp t5 = mSecSinceEpoch();
+  double m = double(N)*reps/1E6;
+  PLATFORM_LOG("intToStr (old): %.1f ns; intToStr: %.1f ns; stbsp_sprintf: %.1f ns (%d)\n",
+      (t1 - t0)/m, (t2 - t1)/m, (t3 - t2)/m, int(tot));
+  PLATFORM_LOG("strtoll: %.1f ns; parseInt: %.1f ns\n", (t4 - t3)/m, (t5 - t4)/m);
+  return 0;
+}
+
+#endif
+
+// g++ -x c++ -O2 -I../stb -DSTRINGUTIL_TEST_WORDS -DSTRINGUTIL_IMPLEMENTATION -o wordtest stringutil.h
+#ifdef STRINGUTIL_TEST_WORDS
+
+#define PLATFORMUTIL_IMPLEMENTATION
+#include "platformutil.h"
+
+static std::string randomChars(size_t len, const char* chars)
+{
+  std::string s(len, '\0');
+  for(char& c : s)
+    c = chars[randpp() % strlen(chars)];
+  return s;
+}
+
+// short words from small alphabet so that there are many partial matches
+static std::string randomWord() { return randomChars(1 + randpp() % 6, "abc-"); }
+
+static std::string randomWordList(int nwords)
+{
+  std::string s;
+  for(int ii = 0; ii < nwords; ++ii)
+    s.append(ii > 0 ? " " : "").append(randomWord());
+  return s;
+}
+
+int main(int argc, char* argv[])
+{
+  srandpp(23);
+  for(int ii = 0; ii < 20000; ++ii) {
+    std::string list = randomWordList(randpp() % 12);
+    WordSet set(list);
+    std::vector<std::string> words;
+    std::vector<StringRef> refs;
+    for(int jj = 0; jj < 20; ++jj)
+      words.push_back(randomWord());
+    for(const std::string& w : words)
+      refs.emplace_back(w);
+    WordMatcher matcher(refs);
+    std::vector<int> found = matcher.findAll(list);
+    std::vector<int> subfound = matcher.findAll(list, '\0');
+    for(size_t jj = 0; jj < words.size(); ++jj) {
+      const char* w = words[jj].c_str();
+      bool has = containsWord(list.c_str(), w);
+      ASSERT(set.contains(w) == has);
+      // matcher only reports first of duplicate words
+      if(std::find(words.begin(), words.begin() + jj, words[jj]) != words.begin() + jj)
+        continue;
+      ASSERT((std::find(found.begin(), found.end(), int(jj)) != found.end()) == has);
+      ASSERT((std::find(subfound.begin(), subfound.end(), int(jj)) != subfound.end())
+          == (strstr(list.c_str(), w) != NULL));
+    }
+    std::string w = randomWord();
+    bool added = set.add(w);
+    ASSERT(added == !containsWord(list.c_str(), w.c_str()));
+    ASSERT(set.contains(w) && WordSet(set.toString()).size() == set.size());
+    if(added) {
+      list = addWord(list, w);
+      ASSERT(set.remove(w) && !set.contains(w));
+      list = removeWord(list, w);
+      ASSERT(!containsWord(list.c_str(), w.c_str()));
+    }
+  }
+  PLATFORM_LOG("WordSet and WordMatcher tests passed\n");
+
+  // style matching: many elements w/ class lists times many selector classes
+  std::vector<std::string> elements;
+  for(int ii = 0; ii < 2000; ++ii)
+    elements.push_back(randomChars(6, "abcdefgh") + " " + randomChars(6, "abcdefgh") + " " + randomChars(6, "abcdefgh"));
+  std::vector<std::string> selectors;
+  std::vector<StringRef> selrefs;
+  WordSet selset;
+  for(int ii = 0; ii < 500; ++ii)
+    selset.add(ii % 10 ? randomChars(6, "abcdefgh") : elements[randpp() % elements.size()].substr(7, 6));
+  selectors = selset.list();  // no duplicates
+  for(const std::string& sel : selectors)
+    selrefs.emplace_back(sel);
+  const int reps = 20;
+  size_t n1 = 0, n2 = 0, n3 = 0;
+  Timestamp t0 = mSecSinceEpoch();
+  for(int r = 0; r < reps; ++r) {
+    for(const std::string& elem : elements) {
+      for(const std::string& sel : selectors)
+        n1 += containsWord(elem.c_str(), sel.c_str());
+    }
+  }
+  Timestamp t1 = mSecSinceEpoch();
+  std::vector<size_t> selhashes;
+  for(const std::string& sel : selectors)
+    selhashes.push_back(WordSet::hash(sel));
+  for(int r = 0; r < reps; ++r) {
+    for(const std::string& elem : elements) {
+      WordSet set(elem);
+      for(size_t ii = 0; ii < selectors.size(); ++ii)
+        n2 += set.contains(selectors[ii], selhashes[ii]);
+    }
+  }
+  Timestamp t2 = mSecSinceEpoch();
+  WordMatcher matcher(selrefs);
+  for(int r = 0; r < reps; ++r) {
+    for(const std::string& elem : elements)
+      matcher.find(elem, [&](int, size_t) { ++n3; });
+  }
+  Timestamp t3 = mSecSinceEpoch();
+  ASSERT(n1 == n2 && n1 == n3);
+  PLATFORM_LOG("containsWord: %d ms; WordSet: %d ms; WordMatcher: %d ms (%d matches)\n",
+      int(t1 - t0), int(t2 - t1), int(t3 - t2), int(n1));
+  return 0;
+}
+
+#endif
+
+// g++ -x c++ -std=c++14 -O2 -march=native -I../stb -DSTRINGUTIL_TEST_HASH -DSTRINGUTIL_IMPLEMENTATION -o hashtest stringutil.h
+#ifdef STRINGUTIL_TEST_HASH
+
+#define PLATFORMUTIL_IMPLEMENTATION
+#include "platformutil.h"
+#define MD5_IMPLEMENTATION
+#include "md5.h"
+#include <unordered_map>
+
+// scalar reference for long input path, to check SIMD fhConsume
+static Hash128 fastHash128Ref(const void* data, size_t len, uint64_t seed)
+{
+  const unsigned char* p = (const unsigned char*)data;
+  uint64_t acc[8], key[24];
+  Hash128 h;
+  fhInit(acc, key, seed);
+  for(size_t ii = 0; ii < (len - 1)/FH_STRIPE_LEN; ++ii) {
+    fhStripe(acc, p + ii*FH_STRIPE_LEN, key + ii % FH_BLOCK_STRIPES);
+    if(ii % FH_BLOCK_STRIPES == FH_BLOCK_STRIPES - 1)
+      fhScramble(acc, key + 16);
+  }
+  fhFinish(acc, p + len - FH_STRIPE_LEN, key, len, &h.lo, &h.hi);
+  return h;
+}
+
+int main(int argc, char* argv[])
+{
+  srandpp(71);
+  std::string data(1 << 16, '\0');
+  for(char& c : data)
+    c = char(randpp());
+
+  for(size_t len = 0; len <= 4096 + 65; len += (len < 1100 ? 1 : 61)) {
+    const char* p = data.data();
+    Hash128 h = fastHash128(p, len, 5);
+    ASSERT(h.lo == fastHash64(p, len, 5));
+    ASSERT(fastHash64(p, len) != fastHash64(p, len, 5));
+    if(len <= 256)
+      ASSERT(h.lo == wyhash(p, len, 5));
+    else
+      ASSERT(h == fastHash128Ref(p, len, 5));
+    // streaming w/ random split points
+    for(int trial = 0; trial < 4; ++trial) {
+      FastHasher hasher(5);
+      size_t pos = 0;
+      while(pos < len) {
+        size_t n = std::min(len - pos, size_t(trial == 0 ? 1 : randpp() % (trial*300)));
+        hasher.update(p + pos, n);
+        pos += n;
+      }
+      ASSERT(hasher.totalLen() == len && hasher.hash128() == h && hasher.hash64() == h.lo);
+    }
+  }
+  // single byte change anywhere changes hash
+  Hash128 h0 = fastHash128(data.data(), data.size());
+  for(size_t ii = 0; ii < data.size(); ii += 997) {
+    data[ii] ^= 1;
+    ASSERT(fastHash128(data.data(), data.size()) != h0);
+    data[ii] ^= 1;
+  }
+  std::unordered_map<StringRef, int> map;
+  map[StringRef("abc")] = 1;
+  ASSERT(map.count(StringRef("abc", 3)) && !map.count(StringRef("abd")));
+
+  // benchmark
+  std::string big(64 << 20, '\0');
+  for(size_t ii = 0; ii < big.size(); ii += 8) {
+    uint64_t r = randpp();
+    memcpy(&big[ii], &r, 8);
+  }
+  uint8_t digest[16];
+  uint64_t sink = 0;
+  Timestamp t0 = mSecSinceEpoch();
+  MD5(big.data(), big.size(), digest);
+  Timestamp t1 = mSecSinceEpoch();
+  for(int ii = 0; ii < 8; ++ii)
+    sink += fastHash64(big.data(), big.size(), ii);
+  Timestamp t2 = mSecSinceEpoch();
+  for(int ii = 0; ii < 8; ++ii)
+    sink += fastHash128(big.data(), big.size(), ii).hi;
+  Timestamp t3 = mSecSinceEpoch();
+  FastHasher hasher;
+  for(int ii = 0; ii < 8; ++ii) {
+    for(size_t pos = 0; pos < big.size(); pos += 1000)
+      hasher.update(&big[pos], std::min(size_t(1000), big.size() - pos));
+  }
+  sink += hasher.hash64();
+  Timestamp t4 = mSecSinceEpoch();
+  size_t nshort = 0;
+  for(size_t ii = 0; ii + 32 <= big.size(); ii += 32, ++nshort)
+    sink += fastHash64(&big[ii], 8 + (ii & 0x1F));
+  Timestamp t5 = mSecSinceEpoch();
+  auto mbps = [](size_t bytes, Timestamp dt) { return int(bytes/(1000.0*std::max(Timestamp(1), dt))); };
+  PLATFORM_LOG("MD5: %d MB/s; fastHash64: %d MB/s; fastHash128: %d MB/s; FastHasher: %d MB/s;"
+      " short keys: %d M/s (%llu)\n", mbps(big.size(), t1 - t0), mbps(8*big.size(), t2 - t1),
+      mbps(8*big.size(), t3 - t2), mbps(8*big.size(), t4 - t3), mbps(nshort, t5 - t4), (unsigned long long)(sink & 0xF));
+  return 0;
+}
+
+#endif
+
+// g++ -x c++ -O2 -I../stb -DSTRINGUTIL_TEST_RNG -DSTRINGUTIL_IMPLEMENTATION -o rngtest stringutil.h -lpthread
+#ifdef STRINGUTIL_TEST_RNG
+
+#define PLATFORMUTIL_IMPLEMENTATION
+#include "platformutil.h"
+#include <thread>
+
+int main(int argc, char* argv[])
+{
+  // reproducible single-threaded sequence
+  std::vector<unsigned int> seq1, seq2;
+  srandpp(1234);
+  for(int ii = 0; ii < 100; ++ii) seq1.push_back(randpp());
+  srandpp(1234);
+  for(int ii = 0; ii < 100; ++ii) seq2.push_back(randpp());
+  ASSERT(seq1 == seq2);
+  ASSERT(randomStr(16) != randomStr(16));
+
+  // threads get different streams; explicit streams are reproducible
+  std::vector<unsigned int> tvals(4), tvals2(4);
+  auto runThreads = [](std::vector<unsigned int>& vals, bool explicitStream) {
+    std::vector<std::thread> threads;
+    for(size_t ii = 0; ii < vals.size(); ++ii) {
+      threads.emplace_back([&vals, ii, explicitStream]() {
+        if(explicitStream) srandppStream(ii + 1);
+        vals[ii] = randpp();
+      });
+    }
+    for(std::thread& t : threads) t.join();
+  };
+  srandpp(99);
+  runThreads(tvals, false);
+  for(size_t ii = 1; ii < tvals.size(); ++ii)
+    ASSERT(std::find(tvals.begin(), tvals.begin() + ii, tvals[ii]) == tvals.begin() + ii);
+  srandpp(99);
+  runThreads(tvals, true);
+  srandpp(99);
+  runThreads(tvals2, true);
+  ASSERT(tvals == tvals2);
+
+  // bounded(): n not a power of 2 so that simple multiply-shift would be biased
+  Rng rng(5);
+  const uint32_t n = 3;
+  size_t counts[n] = {0};
+  for(int ii = 0; ii < 3000000; ++ii)
+    ++counts[rng.bounded(n)];
+  for(size_t c : counts)
+    ASSERT(c > 990000 && c < 1010000);
+  std::vector<uint32_t> vals(1000);
+  rng.fill(vals.data(), vals.size(), 10);
+  ASSERT(*std::max_element(vals.begin(), vals.end()) == 9);
+  unsigned char bytes[13] = {0};
+  rng.fill(bytes, 13);
+  ASSERT(bytes[12] != 0 || bytes[11] != 0);
+  PLATFORM_LOG("Rng tests passed\n");
+
+  const int N = 200000000;
+  unsigned int tot = 0;
+  std::mt19937 mt(1);
+  Timestamp t0 = mSecSinceEpoch();
+  for(int ii = 0; ii < N; ++ii) tot += mt();
+  Timestamp t1 = mSecSinceEpoch();
+  for(int ii = 0; ii < N; ++ii) tot += rng.next32();
+  Timestamp t2 = mSecSinceEpoch();
+  for(int ii = 0; ii < N; ++ii) tot += randpp();
+  Timestamp t3 = mSecSinceEpoch();
+  for(int ii = 0; ii < N; ++ii) tot += rng.bounded(62);
+  Timestamp t4 = mSecSinceEpoch();
+  for(int ii = 0; ii < N; ++ii) tot += rng.next32() % 62;
+  Timestamp t5 = mSecSinceEpoch();
+  for(int ii = 0; ii < N/1000; ++ii) tot += randomStr(1000)[0];
+  Timestamp t6 = mSecSinceEpoch();
+  double m = N/1E6;  // ms -> ns per value
+  PLATFORM_LOG("mt19937: %.2f ns; Rng: %.2f ns; randpp(): %.2f ns; bounded(62): %.2f ns; %% 62: %.2f ns;"
+      " randomStr: %.2f ns/char (%u)\n", (t1 - t0)/m, (t2 - t1)/m, (t3 - t2)/m, (t4 - t3)/m, (t5 - t4)/m,
+      (t6 - t5)/m, tot);
+  return 0;
+}
+
+#endif
+
+// g++ -x c++ -std=c++14 -O2 -I../stb -DSTRINGUTIL_TEST_ATOMS -DSTRINGUTIL_IMPLEMENTATION -o atomtest stringutil.h -lpthread
+#ifdef STRINGUTIL_TEST_ATOMS
+
+#define PLATFORMUTIL_IMPLEMENTATION
+#include "platformutil.h"
+#include <thread>
+
+static constexpr const char* testProps[] = {"color", "width", "height", "fill", "stroke", "stroke-width",
+    "opacity", "font-size", "font-family", "display", "visibility", "transform", "x", "y", "cx", "cy", "r",
+    "margin", "padding", "left", "top", "right", "bottom", "class", "id", "style", "href", "d", "points"};
+static constexpr auto testPropHash = makePerfectHash(testProps);
+static_assert(testPropHash.valid, "perfect hash generation failed");
+static_assert(testPropHash.index("stroke-width") == 5, "constexpr lookup failed");
+static_assert(testPropHash.index("strokewidth") == -1, "constexpr lookup failed");
+
+static int dispatch(const StringRef& name)
+{
+  switch(testPropHash.find(name)) {
+  case testPropHash.index("color"): return 1;
+  case testPropHash.index("points"): return 2;
+  default: return 0;
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  ASSERT(wyhash("", 0) != wyhash("a", 1) && wyhash("abc", 3, 1) != wyhash("abc", 3, 2));
+  for(size_t ii = 0; ii < sizeof(testProps)/sizeof(testProps[0]); ++ii)
+    ASSERT(testPropHash.find(testProps[ii]) == int(ii));
+  ASSERT(testPropHash.find("colour") == -1 && testPropHash.find("") == -1 && testPropHash.find("xx") == -1);
+  ASSERT(testPropHash.find(StringRef("color!", 5)) == 0);
+  ASSERT(dispatch("color") == 1 && dispatch("points") == 2 && dispatch("width") == 0);
+
+  ASSERT(findAtom("never-interned") == 0);
+  int id = atomId("hello");
+  ASSERT(id > 0 && atomId(StringRef("hello world", 5)) == id && findAtom("hello") == id);
+  ASSERT(atomStr(id) == "hello" && atomStr(0).isEmpty() && atomStr(1 << 30).isEmpty());
+
+  // concurrent interning: all threads must agree on ids
+  const int nthreads = 8, natoms = 20000;
+  std::vector<std::vector<int>> ids(nthreads, std::vector<int>(natoms));
+  std::vector<std::thread> threads;
+  for(int t = 0; t < nthreads; ++t) {
+    threads.emplace_back([&ids, t]() {
+      char buff[32];
+      for(int ii = 0; ii < natoms; ++ii) {
+        int jj = (ii*7 + t*1000) % natoms;
+        int n = intToStr(buff, jj);
+        ids[t][jj] = atomId(StringRef(buff, n));
+      }
+    });
+  }
+  for(std::thread& t : threads) t.join();
+  for(int ii = 0; ii < natoms; ++ii) {
+    for(int t = 1; t < nthreads; ++t)
+      ASSERT(ids[t][ii] == ids[0][ii]);
+    ASSERT(atomStr(ids[0][ii]) == std::to_string(ii).c_str());
+  }
+  PLATFORM_LOG("Atom tests passed\n");
+
+  // keyword dispatch: perfect hash vs. indexOfStr
+  std::vector<std::string> names;
+  for(int ii = 0; ii < 1000; ++ii)
+    names.push_back(ii % 4 ? testProps[randpp(sizeof(testProps)/sizeof(testProps[0]))] : "unknown-prop");
+  const int reps = 10000;
+  int tot = 0;
+  Timestamp t0 = mSecSinceEpoch();
+  for(int r = 0; r < reps; ++r) {
+    for(const std::string& name : names)
+      tot += indexOfStr(StringRef(name), testProps);
+  }
+  Timestamp t1 = mSecSinceEpoch();
+  for(int r = 0; r < reps; ++r) {
+    for(const std::string& name : names)
+      tot += testPropHash.find(name);
   }
+  Timestamp t2 = mSecSinceEpoch();
+  for(int r = 0; r < reps; ++r) {
+    for(const std::string& name : names)
+      tot += findAtom(name);
+  }
+  Timestamp t3 = mSecSinceEpoch();
+  double m = names.size()*reps/1E6;
+  PLATFORM_LOG("indexOfStr: %.1f ns; PerfectHash: %.1f ns; findAtom: %.1f ns (%d)\n",
+      (t1 - t0)/m, (t2 - t1)/m, (t3 - t2)/m, tot);
+  return 0;
+}
+
+#endif
+
+// g++ -x c++ -std=c++14 -O2 -I../stb -DSTRINGUTIL_TEST_FSTRING -DSTRINGUTIL_IMPLEMENTATION -o fstringtest stringutil.h
+#ifdef STRINGUTIL_TEST_FSTRING
+
+#define PLATFORMUTIL_IMPLEMENTATION
+#include "platformutil.h"
+
+int main(int argc, char* argv[])
+{
+  std::string str("str");
+  ASSERT(fstring(FMT("{} {} {} {} {} {}"), -42, 42u, INT64_MIN, 'c', true, str) ==
+      "-42 42 -9223372036854775808 c true str");
+  ASSERT(fstring(FMT("{{{}}} {}}}"), StringRef("ref"), "cstr") == "{ref} cstr}");
+  ASSERT(fstring(FMT("{} {} {:.2} {:.3}"), 0.1, 1e300, 3.14159, 2.5f) == "0.1 1e300 3.14 2.5");
+  ASSERT(fstring(FMT("no args")) == "no args");
+  int target = 0;
+  char ptrbuff[32];
+  snprintf(ptrbuff, sizeof(ptrbuff), "0x%llx", (unsigned long long)uintptr_t(&target));
+  ASSERT(fstring(FMT("{}"), &target) == ptrbuff && fstring(FMT("{}"), (const void*)NULL) == "0x0");
+  //fstring(FMT("{:.2}"), 5);  -- compile error: precision only valid for real arguments
+
+  char buff[8];
+  ASSERT(fmtToBuff(buff, sizeof(buff), FMT("{}-{}"), 123456, 789) == 10 && strcmp(buff, "123456-") == 0);
+  ASSERT(fmtToBuff(buff, sizeof(buff), FMT("{}"), 12) == 2 && strcmp(buff, "12") == 0);
+
+  const int reps = 2000000;
+  char out[256];
+  size_t tot = 0;
+  Timestamp t0 = mSecSinceEpoch();
+  for(int ii = 0; ii < reps; ++ii)
+    tot += fmtToBuff(out, sizeof(out), FMT("id {} at {:.2}, {}"), ii, ii*0.37, ii*1.5);
+  Timestamp t1 = mSecSinceEpoch();
+  for(int ii = 0; ii < reps; ++ii)
+    tot += stbsp_snprintf(out, sizeof(out), "id %d at %.2f, %g", ii, ii*0.37, ii*1.5);
+  Timestamp t2 = mSecSinceEpoch();
+  for(int ii = 0; ii < reps; ++ii)
+    tot += fstring(FMT("id {} at {:.2}, {}"), ii, ii*0.37, ii*1.5).size();
+  Timestamp t3 = mSecSinceEpoch();
+  for(int ii = 0; ii < reps; ++ii)
+    tot += fstring("id %d at %.2f, %g", ii, ii*0.37, ii*1.5).size();
+  Timestamp t4 = mSecSinceEpoch();
+  PLATFORM_LOG("fmtToBuff: %d ms; stbsp_snprintf: %d ms\n", int(t1 - t0), int(t2 - t1));
+  PLATFORM_LOG("fstring(FMT()): %d ms; fstring(): %d ms (%d)\n", int(t3 - t2), int(t4 - t3), int(tot));
+
+  StringBuilder sb;
+  sb << "a" << 1 << ' ' << -2.5 << StringRef("ref") << str << false;
+  sb.appendf(" %d", 3).fmt(FMT(" {:.1}"), 0.25).appendReal(1.0/3, 3);
+  ASSERT(sb.ref() == "a1 -2.5refstrfalse 3 0.3" "0.333");
+  std::string released = sb.release();
+  ASSERT(sb.empty() && released.size() == 29);
+  ASSERT(joinStr(std::vector<int>{1, -2, 3}, ", ") == "1, -2, 3");
+  ASSERT(joinStr(std::vector<double>{0.5, 1e-7, 0.1 + 0.2, 1e6}, " ") == "0.5 1e-07 0.3 1e+06");
+  ASSERT(joinStr(std::vector<int8_t>{'A', 'b'}, ",") == "A,b");
+  ASSERT(joinStr(std::vector<const char*>{"x", "y"}, "") == "xy");
+
+  // multi-MB output
+  Timestamp t5 = mSecSinceEpoch();
+  for(int ii = 0; ii < reps; ++ii)
+    sb << "<pt x='" << ii << "' y='" << ii*0.37 << "'/>\n";
+  Timestamp t6 = mSecSinceEpoch();
+  std::string s1;
+  for(int ii = 0; ii < reps; ++ii)
+    s1 += fstring("<pt x='%d' y='%g'/>\n", ii, ii*0.37);
+  Timestamp t7 = mSecSinceEpoch();
+  std::stringstream ss;
+  for(int ii = 0; ii < reps; ++ii)
+    ss << "<pt x='" << ii << "' y='" << ii*0.37 << "'/>\n";
+  Timestamp t8 = mSecSinceEpoch();
+  PLATFORM_LOG("StringBuilder: %d ms; std::string += fstring(): %d ms; std::stringstream: %d ms (%d MB)\n",
+      int(t6 - t5), int(t7 - t6), int(t8 - t7), int(sb.size() >> 20));
   return 0;
 }
 
@@ -37,6 +37,7 @@ Client usage (error checking not shown):
 #define UNET_SHUT_RDWR 2
 #define UNET_RDY_RD 1
 #define UNET_RDY_WR 2
+#define UNET_RDY_ERR 4
 
 //structs
 struct unet_addr {
@@ -121,6 +122,30 @@ int unet_select(int rdsock, int wrsock, double timeout);
 // if ready is not NULL, ready[i] is set if socks[i] has new data
 int unet_multi_select(int* socks, int* ready, int socks_size, double timeout);
 
+// readiness notification for many sockets w/o select()'s FD_SETSIZE limit or per-call setup: epoll on Linux,
+//  poll() elsewhere (or if UNET_USE_POLL is defined); interest is level-triggered, so a socket is reported
+//  on every wait until it is read/written enough to no longer be ready
+struct unet_poller;
+struct unet_event {
+  int sock;
+  int events;  // UNET_RDY_RD | UNET_RDY_WR | UNET_RDY_ERR (error or hangup - reported even if not requested)
+  void* user;  // as passed to unet_poller_add/modify
+};
+
+// returns NULL on failure
+struct unet_poller* unet_poller_create();
+void unet_poller_destroy(struct unet_poller* poller);
+
+// events is UNET_RDY_RD and/or UNET_RDY_WR (or 0 to only get errors); returns 0 on success, -1 on failure
+int unet_poller_add(struct unet_poller* poller, int sock, int events, void* user);
+int unet_poller_modify(struct unet_poller* poller, int sock, int events, void* user);
+// must be called before socket is closed
+int unet_poller_remove(struct unet_poller* poller, int sock);
+
+// waits until timeout elapses (returning 0) or at least one socket is ready, filling up to max_events entries
+//  of events; returns number of entries filled or -1 on error; timeout < 0 blocks indefinitely
+int unet_poller_wait(struct unet_poller* poller, struct unet_event* events, int max_events, double timeout);
+
 #endif //UNET_H
 
 #ifdef UNET_IMPLEMENTATION
@@ -389,4 +414,325 @@ int unet_multi_select(int* socks, int* ready, int socks_size, double timeout)
   return res;
 }
 
+// poller
+#if defined(__linux__) && !defined(UNET_USE_POLL)
+#include <sys/epoll.h>
+#define UNET_EPOLL 1
+#elif !defined(_WIN32)
+#include <poll.h>
+#else
+#define poll WSAPoll  // Vista or later
+#endif
+#include <stdlib.h>  // malloc
+#include <string.h>  // memset
+
+static int unet_timeout_ms(double timeout)
+{
+  // round up so a small positive timeout doesn't become a busy loop
+  return timeout < 0 ? -1 : (int)(timeout*1000.0 + 0.999);
+}
+
+#ifdef UNET_EPOLL
+struct unet_poller {
+  int epfd;
+  void** users;  // indexed by socket
+  int users_size;
+  struct epoll_event* evbuf;
+  int evbuf_size;
+};
+
+struct unet_poller* unet_poller_create()
+{
+  struct unet_poller* poller = (struct unet_poller*)calloc(1, sizeof(struct unet_poller));
+  if(!poller) return NULL;
+  poller->epfd = epoll_create1(EPOLL_CLOEXEC);
+  if(poller->epfd < 0) {
+    free(poller);
+    return NULL;
+  }
+  return poller;
+}
+
+void unet_poller_destroy(struct unet_poller* poller)
+{
+  if(!poller) return;
+  close(poller->epfd);
+  free(poller->users);
+  free(poller->evbuf);
+  free(poller);
+}
+
+static int unet_poller_ctl(struct unet_poller* poller, int op, int sock, int events, void* user)
+{
+  struct epoll_event ev;
+  if(sock < 0) return -1;
+  if(sock >= poller->users_size) {
+    int n = sock < 2*poller->users_size ? 2*poller->users_size : sock + 64;
+    void** users = (void**)realloc(poller->users, n*sizeof(void*));
+    if(!users) return -1;
+    poller->users = users;
+    poller->users_size = n;
+  }
+  memset(&ev, 0, sizeof(ev));
+  ev.events = (events & UNET_RDY_RD ? (uint32_t)EPOLLIN : 0) | (events & UNET_RDY_WR ? (uint32_t)EPOLLOUT : 0);
+  ev.data.fd = sock;
+  if(epoll_ctl(poller->epfd, op, sock, &ev) != 0) return -1;
+  poller->users[sock] = user;
+  return 0;
+}
+
+int unet_poller_add(struct unet_poller* poller, int sock, int events, void* user)
+{
+  return unet_poller_ctl(poller, EPOLL_CTL_ADD, sock, events, user);
+}
+
+int unet_poller_modify(struct unet_poller* poller, int sock, int events, void* user)
+{
+  return unet_poller_ctl(poller, EPOLL_CTL_MOD, sock, events, user);
+}
+
+int unet_poller_remove(struct unet_poller* poller, int sock)
+{
+  struct epoll_event ev;  // ignored, but must be non-NULL for kernels before 2.6.9
+  return epoll_ctl(poller->epfd, EPOLL_CTL_DEL, sock, &ev);
+}
+
+int unet_poller_wait(struct unet_poller* poller, struct unet_event* events, int max_events, double timeout)
+{
+  int n;
+  if(max_events <= 0) return -1;
+  if(max_events > poller->evbuf_size) {
+    struct epoll_event* evbuf = (struct epoll_event*)realloc(poller->evbuf, max_events*sizeof(struct epoll_event));
+    if(!evbuf) return -1;
+    poller->evbuf = evbuf;
+    poller->evbuf_size = max_events;
+  }
+  n = epoll_wait(poller->epfd, poller->evbuf, max_events, unet_timeout_ms(timeout));
+  for(int i = 0; i < n; i++) {
+    struct epoll_event* ev = &poller->evbuf[i];
+    events[i].sock = ev->data.fd;
+    events[i].events = (ev->events & EPOLLIN ? UNET_RDY_RD : 0) | (ev->events & EPOLLOUT ? UNET_RDY_WR : 0)
+        | (ev->events & (EPOLLERR | EPOLLHUP) ? UNET_RDY_ERR : 0);
+    events[i].user = poller->users[ev->data.fd];
+  }
+  return n;
+}
+
+#else  // poll()
+struct unet_poller {
+  struct pollfd* fds;
+  void** users;  // users[i] for fds[i]
+  int count;
+  int cap;
+  int next;  // index to start reporting from, so first sockets can't starve others when max_events is hit
+};
+
+struct unet_poller* unet_poller_create()
+{
+  return (struct unet_poller*)calloc(1, sizeof(struct unet_poller));
+}
+
+void unet_poller_destroy(struct unet_poller* poller)
+{
+  if(!poller) return;
+  free(poller->fds);
+  free(poller->users);
+  free(poller);
+}
+
+// linear search is fine since poll() itself is O(n) anyway
+static int unet_poller_find(struct unet_poller* poller, int sock)
+{
+  for(int i = 0; i < poller->count; i++) {
+    if((int)poller->fds[i].fd == sock) return i;
+  }
+  return -1;
+}
+
+static short unet_poll_events(int events)
+{
+  return (events & UNET_RDY_RD ? POLLIN : 0) | (events & UNET_RDY_WR ? POLLOUT : 0);
+}
+
+int unet_poller_add(struct unet_poller* poller, int sock, int events, void* user)
+{
+  if(sock < 0 || unet_poller_find(poller, sock) >= 0) return -1;
+  if(poller->count == poller->cap) {
+    int n = poller->cap ? 2*poller->cap : 64;
+    struct pollfd* fds = (struct pollfd*)realloc(poller->fds, n*sizeof(struct pollfd));
+    if(!fds) return -1;
+    poller->fds = fds;
+    void** users = (void**)realloc(poller->users, n*sizeof(void*));
+    if(!users) return -1;
+    poller->users = users;
+    poller->cap = n;
+  }
+  poller->fds[poller->count].fd = sock;
+  poller->fds[poller->count].events = unet_poll_events(events);
+  poller->fds[poller->count].revents = 0;
+  poller->users[poller->count] = user;
+  poller->count++;
+  return 0;
+}
+
+int unet_poller_modify(struct unet_poller* poller, int sock, int events, void* user)
+{
+  int i = unet_poller_find(poller, sock);
+  if(i < 0) return -1;
+  poller->fds[i].events = unet_poll_events(events);
+  poller->users[i] = user;
+  return 0;
+}
+
+int unet_poller_remove(struct unet_poller* poller, int sock)
+{
+  int i = unet_poller_find(poller, sock);
+  if(i < 0) return -1;
+  poller->count--;
+  poller->fds[i] = poller->fds[poller->count];
+  poller->users[i] = poller->users[poller->count];
+  return 0;
+}
+
+int unet_poller_wait(struct unet_poller* poller, struct unet_event* events, int max_events, double timeout)
+{
+  int res, n = 0;
+  if(max_events <= 0) return -1;
+  res = poll(poller->fds, poller->count, unet_timeout_ms(timeout));
+  if(res <= 0) return res;
+  if(poller->next >= poller->count) poller->next = 0;
+  for(int j = 0; j < poller->count && n < max_events; j++) {
+    int i = (poller->next + j) % poller->count;
+    short re = poller->fds[i].revents;
+    if(!re) continue;
+    events[n].sock = (int)poller->fds[i].fd;
+    events[n].events = (re & POLLIN ? UNET_RDY_RD : 0) | (re & POLLOUT ? UNET_RDY_WR : 0)
+        | (re & (POLLERR | POLLHUP | POLLNVAL) ? UNET_RDY_ERR : 0);
+    events[n].user = poller->users[i];
+    if(++n == max_events) poller->next = i + 1;
+  }
+  return n;
+}
+#endif  // UNET_EPOLL
+
 #endif //UNET_IMPLEMENTATION
+
+// g++ -x c++ -O2 -DUNET_TEST -DUNET_IMPLEMENTATION -o unettest unet.h  (add -DUNET_USE_POLL to test poll())
+// ./unettest [idle connections] [active connections] - poller test and benchmark over loopback
+#ifdef UNET_TEST
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <vector>
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+// unlike CHECK(), not disabled by NDEBUG
+#define CHECK(x) do { if(!(x)) { fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #x); exit(1); } } while(0)
+
+int main(int argc, char* argv[])
+{
+  int nidle = argc > 1 ? atoi(argv[1]) : 10000;
+  int nactive = argc > 2 ? atoi(argv[2]) : 100;
+#ifndef _WIN32
+  // each connection uses two fds (both ends are in this process)
+  struct rlimit rl;
+  getrlimit(RLIMIT_NOFILE, &rl);
+  rl.rlim_cur = rl.rlim_max;
+  setrlimit(RLIMIT_NOFILE, &rl);
+  int maxconn = (int)(rl.rlim_cur > 1000000 ? 1000000 : rl.rlim_cur)/2 - 32;
+  if(nidle + nactive > maxconn) {
+    printf("fd limit %d: reducing idle connections from %d to %d\n", (int)rl.rlim_cur, nidle, maxconn - nactive);
+    nidle = maxconn - nactive;
+  }
+#endif
+
+  unet_init();
+  int listener = unet_socket(UNET_TCP, UNET_BIND, UNET_DEFAULT, "127.0.0.1", "0");
+  CHECK(listener >= 0 && unet_listen(listener, 1024) == 0);
+  struct unet_addr addr;
+  char port[16];
+  unet_address(listener, &addr);
+  unet_address_info(&addr, NULL, 0, port, sizeof(port));
+
+  std::vector<int> clients, servers;
+  for(int ii = 0; ii < nidle + nactive; ++ii) {
+    int c = unet_socket(UNET_TCP, UNET_CONNECT, UNET_NODELAY, "127.0.0.1", port);
+    int s = unet_accept(listener, NULL);
+    CHECK(c >= 0 && s >= 0);
+    clients.push_back(c);
+    servers.push_back(s);
+  }
+
+  // basic behavior
+  struct unet_poller* poller = unet_poller_create();
+  struct unet_event ev[256];
+  int c0 = clients[0], s0 = servers[0];
+  CHECK(unet_poller_add(poller, s0, UNET_RDY_RD | UNET_RDY_WR, &servers[0]) == 0);
+  CHECK(unet_poller_add(poller, s0, UNET_RDY_RD, NULL) != 0);  // already added
+  CHECK(unet_poller_wait(poller, ev, 8, 0) == 1 && ev[0].sock == s0 && ev[0].events == UNET_RDY_WR
+      && ev[0].user == &servers[0]);
+  CHECK(unet_poller_modify(poller, s0, UNET_RDY_RD, NULL) == 0);
+  CHECK(unet_poller_wait(poller, ev, 8, 0.01) == 0);
+  unet_send(c0, "x", 1);
+  CHECK(unet_poller_wait(poller, ev, 8, 1) == 1 && ev[0].events == UNET_RDY_RD && ev[0].user == NULL);
+  CHECK(unet_poller_wait(poller, ev, 8, 0) == 1);  // level triggered
+  char buf[64];
+  CHECK(unet_recv(s0, buf, sizeof(buf)) == 1);
+  CHECK(unet_poller_wait(poller, ev, 8, 0) == 0);
+  CHECK(unet_poller_remove(poller, s0) == 0 && unet_poller_remove(poller, s0) != 0);
+  unet_send(c0, "x", 1);
+  CHECK(unet_poller_wait(poller, ev, 8, 0.01) == 0);
+  CHECK(unet_poller_modify(poller, s0, UNET_RDY_RD, NULL) != 0);
+  unet_recv(s0, buf, sizeof(buf));
+
+  // benchmark: all connections registered, the active ones each send a message per round
+  for(size_t ii = 0; ii < servers.size(); ++ii)
+    CHECK(unet_poller_add(poller, servers[ii], UNET_RDY_RD, (void*)ii) == 0);
+  int rounds = 2000;
+  size_t nwaits = 0, nevents = 0;
+  auto t0 = std::chrono::steady_clock::now();
+  for(int round = 0; round < rounds; ++round) {
+    for(int ii = 0; ii < nactive; ++ii)
+      unet_send(clients[nidle + ii], "ping", 4);
+    int pending = nactive;
+    while(pending > 0) {
+      int n = unet_poller_wait(poller, ev, 256, 1);
+      CHECK(n > 0);
+      ++nwaits;
+      for(int jj = 0; jj < n; ++jj) {
+        CHECK((size_t)ev[jj].user >= (size_t)nidle && ev[jj].events == UNET_RDY_RD);
+        pending -= unet_recv(ev[jj].sock, buf, sizeof(buf))/4;
+        ++nevents;
+      }
+    }
+  }
+  double dt = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+  printf("%s: %d idle + %d active connections: %.0f msgs/s, %.1f us per wait (%.1f events per wait)\n",
+#ifdef UNET_EPOLL
+      "epoll",
+#else
+      "poll",
+#endif
+      nidle, nactive, rounds*nactive/dt, 1E6*dt/nwaits, double(nevents)/nwaits);
+
+  // peer close is reported as readable (recv returns 0)
+  unet_close(clients[nidle]);
+  CHECK(unet_poller_wait(poller, ev, 256, 1) == 1 && ev[0].sock == servers[nidle]
+      && unet_recv(servers[nidle], buf, sizeof(buf)) == 0);
+  unet_poller_remove(poller, servers[nidle]);
+  unet_close(servers[nidle]);
+  clients[nidle] = servers[nidle] = -1;
+
+  unet_poller_destroy(poller);
+  for(size_t ii = 0; ii < clients.size(); ++ii) {
+    if(clients[ii] >= 0) unet_close(clients[ii]);
+    if(servers[ii] >= 0) unet_close(servers[ii]);
+  }
+  unet_close(listener);
+  unet_terminate();
+  printf("All tests passed\n");
+  return 0;
+}
+#endif